@@ -0,0 +1,37 @@
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+#include "bench.hpp"
+
+// Every allocation of the program goes through here, so that benchmarks can report them
+
+void* operator new(std::size_t size) {
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* pointer {std::malloc(size == 0 ? 1 : size)}) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
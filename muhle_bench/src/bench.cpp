@@ -0,0 +1,190 @@
+#include "bench.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include <boost/asio/ip/host_name.hpp>
+
+namespace bench {
+    using Clock = std::chrono::steady_clock;
+
+    void Harness::add(const std::string& name, std::function<void()>&& body) {
+        m_benchmarks.push_back({name, std::move(body)});
+    }
+
+    void Harness::run() {
+        m_results.clear();
+
+        std::printf("%-36s %14s %12s %10s %12s\n", "benchmark", "median (ns)", "mad (ns)", "mad (%)", "allocations");
+
+        for (const Benchmark& benchmark : m_benchmarks) {
+            if (benchmark.name.find(m_settings.filter) == std::string::npos) {
+                continue;
+            }
+
+            const Result result {measure(benchmark)};
+
+            std::printf(
+                "%-36s %14.1f %12.1f %10.2f %12.2f\n",
+                result.name.c_str(),
+                result.median,
+                result.mad,
+                result.median > 0.0 ? result.mad / result.median * 100.0 : 0.0,
+                result.allocations
+            );
+            std::fflush(stdout);
+
+            m_results.push_back(result);
+        }
+    }
+
+    Result Harness::measure(const Benchmark& benchmark) const {
+        // Double the iterations until a sample takes long enough to be timed reliably
+        std::size_t iterations {1};
+
+        while (true) {
+            const auto begin {Clock::now()};
+
+            for (std::size_t i {0}; i < iterations; i++) {
+                benchmark.body();
+            }
+
+            const std::chrono::duration<double> elapsed {Clock::now() - begin};
+
+            if (elapsed.count() >= m_settings.sample_time || iterations >= (std::size_t(1) << 30)) {
+                break;
+            }
+
+            // Jump close to the target, instead of only doubling, when the body is fast
+            const double factor {elapsed.count() > 0.0 ? m_settings.sample_time / elapsed.count() : 1000.0};
+            iterations = std::max(iterations * 2, static_cast<std::size_t>(static_cast<double>(iterations) * std::min(factor, 1000.0)));
+        }
+
+        Result result;
+        result.name = benchmark.name;
+        result.iterations = iterations;
+
+        std::uint64_t allocations_total {0};
+
+        for (unsigned int sample {0}; sample < m_settings.warmup + m_settings.repetitions; sample++) {
+            const auto allocations_begin {allocations.load(std::memory_order_relaxed)};
+            const auto begin {Clock::now()};
+
+            for (std::size_t i {0}; i < iterations; i++) {
+                benchmark.body();
+            }
+
+            const auto end {Clock::now()};
+            const auto allocations_end {allocations.load(std::memory_order_relaxed)};
+
+            if (sample < m_settings.warmup) {
+                continue;
+            }
+
+            const std::chrono::duration<double, std::nano> elapsed {end - begin};
+
+            result.samples.push_back(elapsed.count() / static_cast<double>(iterations));
+            allocations_total += allocations_end - allocations_begin;
+        }
+
+        std::vector<double> deviations;
+
+        result.median = median(result.samples);
+        result.min = *std::min_element(result.samples.cbegin(), result.samples.cend());
+
+        for (const double sample : result.samples) {
+            deviations.push_back(std::abs(sample - result.median));
+        }
+
+        result.mad = median(deviations);
+        result.allocations = static_cast<double>(allocations_total) / static_cast<double>(iterations * result.samples.size());
+
+        return result;
+    }
+
+    void Harness::write_json(const std::string& file_path) const {
+        std::ofstream stream {file_path, std::ios::trunc};
+
+        if (!stream.is_open()) {
+            throw std::runtime_error("Could not open file `" + file_path + "`");
+        }
+
+        char buffer[64] {};
+
+        const auto number {[&buffer](double value) {
+            std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+            return buffer;
+        }};
+
+        stream << "{\n";
+        stream << "  \"version\": 1,\n";
+        stream << "  \"host\": \"" << host_name() << "\",\n";
+#ifdef NDEBUG
+        stream << "  \"assertions\": false,\n";
+#else
+        stream << "  \"assertions\": true,\n";
+#endif
+        stream << "  \"warmup\": " << m_settings.warmup << ",\n";
+        stream << "  \"repetitions\": " << m_settings.repetitions << ",\n";
+        stream << "  \"benchmarks\": [\n";
+
+        for (std::size_t i {0}; i < m_results.size(); i++) {
+            const Result& result {m_results[i]};
+
+            // Names are plain identifiers; nothing needs to be escaped
+            stream << "    {\n";
+            stream << "      \"name\": \"" << result.name << "\",\n";
+            stream << "      \"iterations\": " << result.iterations << ",\n";
+            stream << "      \"median_ns\": " << number(result.median) << ",\n";
+            stream << "      \"mad_ns\": " << number(result.mad) << ",\n";
+            stream << "      \"min_ns\": " << number(result.min) << ",\n";
+            stream << "      \"allocations\": " << number(result.allocations) << ",\n";
+            stream << "      \"samples_ns\": [";
+
+            for (std::size_t j {0}; j < result.samples.size(); j++) {
+                stream << (j > 0 ? ", " : "") << number(result.samples[j]);
+            }
+
+            stream << "]\n";
+            stream << "    }" << (i + 1 < m_results.size() ? "," : "") << '\n';
+        }
+
+        stream << "  ]\n";
+        stream << "}\n";
+
+        if (!stream) {
+            throw std::runtime_error("Could not write file `" + file_path + "`");
+        }
+    }
+
+    std::string host_name() {
+        try {
+            return boost::asio::ip::host_name();
+        } catch (const boost::system::system_error&) {
+            return "unknown";
+        }
+    }
+
+    double median(std::vector<double> values) {
+        if (values.empty()) {
+            return 0.0;
+        }
+
+        const auto middle {values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2)};
+        std::nth_element(values.begin(), middle, values.end());
+
+        if (values.size() % 2 == 1) {
+            return *middle;
+        }
+
+        const double upper {*middle};
+        const double lower {*std::max_element(values.begin(), middle)};
+
+        return (lower + upper) / 2.0;
+    }
+}
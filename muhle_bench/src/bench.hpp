@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bench {
+    // Counted by the replaced global operator new
+    inline std::atomic<std::uint64_t> allocations {0};
+
+    // Keep the compiler from optimizing a result away
+    template<typename T>
+    void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        __asm__ __volatile__("" : : "r,m"(value) : "memory");
+#else
+        static_cast<void>(*static_cast<const volatile char*>(static_cast<const volatile void*>(&value)));
+#endif
+    }
+
+    struct Settings {
+        unsigned int warmup {3};  // Samples thrown away
+        unsigned int repetitions {15};  // Samples kept
+        double sample_time {0.01};  // Seconds; the iterations per sample are chosen to take about this long
+        std::string filter;
+    };
+
+    struct Result {
+        std::string name;
+        std::size_t iterations {};  // Per sample
+        std::vector<double> samples;  // Nanoseconds per iteration
+        double median {};
+        double mad {};  // Median absolute deviation
+        double min {};
+        double allocations {};  // Per iteration
+    };
+
+    class Harness {
+    public:
+        explicit Harness(const Settings& settings)
+            : m_settings(settings) {}
+
+        // The body runs one iteration
+        void add(const std::string& name, std::function<void()>&& body);
+        void run();
+
+        const std::vector<Result>& get_results() const { return m_results; }
+        void write_json(const std::string& file_path) const;
+    private:
+        struct Benchmark {
+            std::string name;
+            std::function<void()> body;
+        };
+
+        Result measure(const Benchmark& benchmark) const;
+
+        Settings m_settings;
+        std::vector<Benchmark> m_benchmarks;
+        std::vector<Result> m_results;
+    };
+
+    double median(std::vector<double> values);
+
+    // Results are only comparable between runs on the same machine
+    std::string host_name();
+}
@@ -0,0 +1,138 @@
+#include "benchmarks.hpp"
+
+#include <iostream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+
+#include "board.hpp"
+#include "engine.hpp"
+#include "subprocess.hpp"
+
+namespace benchmarks {
+    // Nine men's morris positions, one for every phase
+    static constexpr const char* PLACING {"w:wa7,d6,g1:bb4,f4,d2:5"};
+    static constexpr const char* MOVING {"w:wa7,d7,b6,c5,a4,c3,b2,d1,g4:bg7,f6,e5,d5,e4,e3,f2,g1,d3:10"};
+    static constexpr const char* FLYING {"w:wa7,d5,g1:bb6,d6,f2,c3,e4,d1:20"};
+
+    // Neither side closes a mill, so the position comes back every four plies
+    static constexpr std::array<const char*, 4> SHUFFLE {"a4-a1", "f2-d2", "a1-a4", "d2-f2"};
+
+    static constexpr const char* INFO {"info depth 12 time 1534 nodes 2345678 score eval -37 pv a1-a4 f2-d2xb6 a4-a1 d2-f2 g4-g7"};
+
+    static constexpr std::size_t ECHO_LINES {64};
+
+    static void add_generate_moves(bench::Harness& harness, const char* name, const char* string) {
+        harness.add(name, [position = board::position_from_string(string)]() {
+            bench::do_not_optimize(board::Board::generate_moves(position, board::NINE));
+        });
+    }
+
+    void add_board(bench::Harness& harness) {
+        add_generate_moves(harness, "generate_moves/placing", PLACING);
+        add_generate_moves(harness, "generate_moves/moving", MOVING);
+        add_generate_moves(harness, "generate_moves/flying", FLYING);
+
+        harness.add("is_mill", [position = board::position_from_string(MOVING)]() {
+            int mills {0};
+
+            for (int i {0}; i < 24; i++) {
+                if (position.board[static_cast<std::size_t>(i)] != board::Node::None) {
+                    const auto player {static_cast<board::Player>(position.board[static_cast<std::size_t>(i)])};
+                    mills += static_cast<int>(board::Board::is_mill(position.board, player, i, board::NINE));
+                }
+            }
+
+            bench::do_not_optimize(mills);
+        });
+
+        // Every move of the moving phase goes through the threefold repetition check
+        auto shuffle_board {std::make_shared<board::Board>([](const board::Move&) {})};
+        shuffle_board->reset(board::position_from_string(MOVING));
+
+        std::vector<board::Move> shuffle;
+
+        for (const char* move : SHUFFLE) {
+            shuffle.push_back(board::move_from_string(move));
+        }
+
+        harness.add("play_move/repetition", [shuffle_board, shuffle]() {
+            for (const board::Move& move : shuffle) {
+                shuffle_board->play_move(move);
+            }
+
+            shuffle_board->jump(0);
+        });
+
+        harness.add("move_to_string", [moves = std::vector<board::Move> {
+            board::Move::create_place(0),
+            board::Move::create_place_capture(9, 4),
+            board::Move::create_move(0, 9),
+            board::Move::create_move_capture(0, 9, 4)
+        }]() {
+            for (const board::Move& move : moves) {
+                bench::do_not_optimize(board::move_to_string(move));
+            }
+        });
+
+        harness.add("move_from_string", [strings = std::vector<std::string> {"a7", "b4xd7", "a7-a4", "a7-a4xd7"}]() {
+            for (const std::string& string : strings) {
+                bench::do_not_optimize(board::move_from_string(string));
+            }
+        });
+
+        harness.add("position_from_string", [string = std::string(MOVING)]() {
+            bench::do_not_optimize(board::position_from_string(string));
+        });
+
+        harness.add("position_to_string", [position = board::position_from_string(MOVING)]() {
+            bench::do_not_optimize(board::position_to_string(position));
+        });
+    }
+
+    void add_engine(bench::Harness& harness) {
+        harness.add("parse_message", [message = std::string(INFO)]() {
+            bench::do_not_optimize(engine::SubprocessEngine::parse_message(message));
+        });
+
+        harness.add("parse_info", [tokens = engine::SubprocessEngine::parse_message(INFO)]() {
+            bench::do_not_optimize(engine::SubprocessEngine::parse_info(tokens));
+        });
+    }
+
+    void add_subprocess(bench::Harness& harness, const std::string& echo_file_path) {
+        auto process {std::make_shared<subprocess::Subprocess>()};
+        process->open(echo_file_path);
+
+        // Lines are written in a batch and then read back, so that the pipes stay busy
+        harness.add("subprocess/echo_64_lines", [process, line = std::string(INFO)]() {
+            for (std::size_t i {0}; i < ECHO_LINES; i++) {
+                process->write_line(line);
+            }
+
+            const auto deadline {std::chrono::steady_clock::now() + std::chrono::seconds(5)};
+
+            for (std::size_t i {0}; i < ECHO_LINES;) {
+                if (!process->read_line(deadline).empty()) {
+                    i++;
+                } else if (std::chrono::steady_clock::now() >= deadline) {
+                    throw std::runtime_error("The echo process doesn't answer");
+                }
+            }
+        });
+    }
+
+    int echo() {
+        std::string line;
+
+        // Flushed after every line, like an engine would
+        while (std::getline(std::cin, line)) {
+            std::cout << line << std::endl;
+        }
+
+        return 0;
+    }
+}
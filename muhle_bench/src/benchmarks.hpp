@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+#include "bench.hpp"
+
+namespace benchmarks {
+    void add_board(bench::Harness& harness);
+    void add_engine(bench::Harness& harness);
+
+    // The echo process is this program, started with ECHO_VARIABLE set
+    void add_subprocess(bench::Harness& harness, const std::string& echo_file_path);
+    int echo();
+
+    inline constexpr const char* ECHO_VARIABLE {"MUHLE_BENCH_ECHO"};
+}
@@ -0,0 +1,395 @@
+#include "compare.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <stdexcept>
+
+namespace compare {
+    // Just enough JSON for the files written by the harness; unknown values are skipped
+    class Reader {
+    public:
+        explicit Reader(const std::string& buffer)
+            : m_buffer(buffer) {}
+
+        ResultsFile read_results() {
+            ResultsFile file;
+
+            read_object([&](const std::string& key) {
+                if (key == "host") {
+                    file.host = read_string();
+                } else if (key == "benchmarks") {
+                    read_array([&]() {
+                        file.results.push_back(read_result());
+                    });
+                } else {
+                    skip_value();
+                }
+            });
+
+            return file;
+        }
+    private:
+        bench::Result read_result() {
+            bench::Result result;
+
+            read_object([&](const std::string& key) {
+                if (key == "name") {
+                    result.name = read_string();
+                } else if (key == "iterations") {
+                    result.iterations = static_cast<std::size_t>(read_number());
+                } else if (key == "median_ns") {
+                    result.median = read_number();
+                } else if (key == "mad_ns") {
+                    result.mad = read_number();
+                } else if (key == "min_ns") {
+                    result.min = read_number();
+                } else if (key == "allocations") {
+                    result.allocations = read_number();
+                } else if (key == "samples_ns") {
+                    read_array([&]() {
+                        result.samples.push_back(read_number());
+                    });
+                } else {
+                    skip_value();
+                }
+            });
+
+            if (result.name.empty() || result.samples.empty()) {
+                throw std::runtime_error("Benchmark without a name or samples");
+            }
+
+            return result;
+        }
+
+        template<typename F>
+        void read_object(F&& read_member) {
+            expect('{');
+
+            if (accept('}')) {
+                return;
+            }
+
+            do {
+                const std::string key {read_string()};
+                expect(':');
+                read_member(key);
+            } while (accept(','));
+
+            expect('}');
+        }
+
+        template<typename F>
+        void read_array(F&& read_element) {
+            expect('[');
+
+            if (accept(']')) {
+                return;
+            }
+
+            do {
+                read_element();
+            } while (accept(','));
+
+            expect(']');
+        }
+
+        std::string read_string() {
+            expect('"');
+
+            std::string result;
+
+            while (m_index < m_buffer.size() && m_buffer[m_index] != '"') {
+                if (m_buffer[m_index] == '\\') {
+                    m_index++;
+                }
+
+                if (m_index < m_buffer.size()) {
+                    result += m_buffer[m_index++];
+                }
+            }
+
+            expect('"');
+
+            return result;
+        }
+
+        double read_number() {
+            skip_whitespace();
+
+            const char* begin {m_buffer.c_str() + m_index};
+            char* end {nullptr};
+            const double result {std::strtod(begin, &end)};
+
+            if (end == begin) {
+                error("number");
+            }
+
+            m_index += static_cast<std::size_t>(end - begin);
+
+            return result;
+        }
+
+        void skip_value() {
+            skip_whitespace();
+
+            if (m_index == m_buffer.size()) {
+                error("value");
+            }
+
+            switch (m_buffer[m_index]) {
+                case '{':
+                    read_object([this](const std::string&) { skip_value(); });
+                    break;
+                case '[':
+                    read_array([this]() { skip_value(); });
+                    break;
+                case '"':
+                    read_string();
+                    break;
+                default:
+                    // Numbers and literals
+                    while (m_index < m_buffer.size() && std::strchr(",]}", m_buffer[m_index]) == nullptr) {
+                        m_index++;
+                    }
+                    break;
+            }
+        }
+
+        void expect(char character) {
+            if (!accept(character)) {
+                error(std::string(1, character).c_str());
+            }
+        }
+
+        bool accept(char character) {
+            skip_whitespace();
+
+            if (m_index < m_buffer.size() && m_buffer[m_index] == character) {
+                m_index++;
+                return true;
+            }
+
+            return false;
+        }
+
+        void skip_whitespace() {
+            while (m_index < m_buffer.size() && std::isspace(static_cast<unsigned char>(m_buffer[m_index]))) {
+                m_index++;
+            }
+        }
+
+        [[noreturn]] void error(const char* expected) const {
+            throw std::runtime_error("Expected `" + std::string(expected) + "` at offset " + std::to_string(m_index));
+        }
+
+        const std::string& m_buffer;
+        std::size_t m_index {0};
+    };
+
+    ResultsFile read_json(const std::string& file_path) {
+        std::ifstream stream {file_path};
+
+        if (!stream.is_open()) {
+            throw std::runtime_error("Could not open file `" + file_path + "`");
+        }
+
+        std::ostringstream buffer;
+        buffer << stream.rdbuf();
+
+        const std::string contents {buffer.str()};
+
+        try {
+            return Reader(contents).read_results();
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error("Could not read file `" + file_path + "`: " + e.what());
+        }
+    }
+
+    void check_host(const ResultsFile& baseline, const std::string& host) {
+        if (baseline.host == host) {
+            return;
+        }
+
+        std::fprintf(
+            stderr,
+            "Warning: the baseline was recorded on `%s`, not on `%s`; the differences may only be the hardware\n",
+            baseline.host.empty() ? "an unknown machine" : baseline.host.c_str(),
+            host.c_str()
+        );
+    }
+
+    static std::vector<double> resample(const std::vector<double>& samples, std::mt19937& generator) {
+        std::uniform_int_distribution<std::size_t> distribution {0, samples.size() - 1};
+        std::vector<double> result;
+
+        for (std::size_t i {0}; i < samples.size(); i++) {
+            result.push_back(samples[distribution(generator)]);
+        }
+
+        return result;
+    }
+
+    // Percentile bootstrap of the ratio of the medians
+    static void confidence_interval(
+        const bench::Result& baseline,
+        const bench::Result& current,
+        const Settings& settings,
+        Comparison& comparison
+    ) {
+        // Fixed seed, so that the same files always give the same verdict
+        std::mt19937 generator {1};
+        std::vector<double> changes;
+
+        for (unsigned int i {0}; i < settings.resamples; i++) {
+            const double baseline_median {bench::median(resample(baseline.samples, generator))};
+            const double current_median {bench::median(resample(current.samples, generator))};
+
+            if (baseline_median > 0.0) {
+                changes.push_back(current_median / baseline_median - 1.0);
+            }
+        }
+
+        if (changes.empty()) {
+            return;
+        }
+
+        std::sort(changes.begin(), changes.end());
+
+        const double tail {(1.0 - settings.confidence) / 2.0};
+        const auto last {static_cast<double>(changes.size() - 1)};
+
+        comparison.low = changes[static_cast<std::size_t>(tail * last)];
+        comparison.high = changes[static_cast<std::size_t>((1.0 - tail) * last)];
+    }
+
+    std::vector<Comparison> compare(
+        const std::vector<bench::Result>& baseline,
+        const std::vector<bench::Result>& current,
+        const Settings& settings
+    ) {
+        std::vector<Comparison> comparisons;
+
+        for (const bench::Result& result : current) {
+            Comparison comparison;
+            comparison.name = result.name;
+            comparison.current = result.median;
+
+            const auto iter {std::find_if(baseline.cbegin(), baseline.cend(), [&](const bench::Result& baseline_result) {
+                return baseline_result.name == result.name;
+            })};
+
+            if (iter == baseline.cend()) {
+                comparison.verdict = Verdict::New;
+                comparisons.push_back(comparison);
+                continue;
+            }
+
+            comparison.baseline = iter->median;
+            comparison.change = iter->median > 0.0 ? result.median / iter->median - 1.0 : 0.0;
+
+            confidence_interval(*iter, result, settings, comparison);
+
+            if (comparison.low > settings.threshold) {
+                comparison.verdict = Verdict::Regression;
+            } else if (comparison.high < -settings.threshold) {
+                comparison.verdict = Verdict::Improvement;
+            } else {
+                comparison.verdict = Verdict::Unchanged;
+            }
+
+            comparisons.push_back(comparison);
+        }
+
+        for (const bench::Result& result : baseline) {
+            const auto iter {std::find_if(current.cbegin(), current.cend(), [&](const bench::Result& current_result) {
+                return current_result.name == result.name;
+            })};
+
+            if (iter == current.cend()) {
+                Comparison comparison;
+                comparison.name = result.name;
+                comparison.baseline = result.median;
+                comparison.verdict = Verdict::Missing;
+
+                comparisons.push_back(comparison);
+            }
+        }
+
+        return comparisons;
+    }
+
+    static const char* verdict_to_string(Verdict verdict) {
+        switch (verdict) {
+            case Verdict::Unchanged:
+                return "";
+            case Verdict::Regression:
+                return "REGRESSION";
+            case Verdict::Improvement:
+                return "improvement";
+            case Verdict::New:
+                return "new";
+            case Verdict::Missing:
+                return "missing";
+        }
+
+        return "";
+    }
+
+    unsigned int print(const std::vector<Comparison>& comparisons, const Settings& settings) {
+        unsigned int regressions {0};
+
+        std::printf(
+            "\n%-36s %14s %14s %10s %20s  %s\n",
+            "benchmark",
+            "baseline (ns)",
+            "current (ns)",
+            "change (%)",
+            "interval (%)",
+            "verdict"
+        );
+
+        for (const Comparison& comparison : comparisons) {
+            switch (comparison.verdict) {
+                case Verdict::New:
+                    std::printf("%-36s %14s %14.1f %10s %20s  %s\n", comparison.name.c_str(), "-", comparison.current, "-", "-", "new");
+                    continue;
+                case Verdict::Missing:
+                    std::printf("%-36s %14.1f %14s %10s %20s  %s\n", comparison.name.c_str(), comparison.baseline, "-", "-", "-", "missing");
+                    continue;
+                case Verdict::Regression:
+                    regressions++;
+                    break;
+                default:
+                    break;
+            }
+
+            char interval[32] {};
+            std::snprintf(interval, sizeof(interval), "[%+.2f, %+.2f]", comparison.low * 100.0, comparison.high * 100.0);
+
+            std::printf(
+                "%-36s %14.1f %14.1f %+10.2f %20s  %s\n",
+                comparison.name.c_str(),
+                comparison.baseline,
+                comparison.current,
+                comparison.change * 100.0,
+                interval,
+                verdict_to_string(comparison.verdict)
+            );
+        }
+
+        std::printf(
+            "\n%u regression(s) beyond %.1f%% at %.0f%% confidence\n",
+            regressions,
+            settings.threshold * 100.0,
+            settings.confidence * 100.0
+        );
+
+        return regressions;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace compare {
+    enum class Verdict {
+        Unchanged,
+        Regression,
+        Improvement,
+        New,  // Not in the baseline
+        Missing  // Only in the baseline
+    };
+
+    struct Settings {
+        double threshold {0.05};  // Relative change of the median that is tolerated
+        double confidence {0.95};
+        unsigned int resamples {10000};
+    };
+
+    struct Comparison {
+        std::string name;
+        double baseline {};  // Median in nanoseconds
+        double current {};
+        double change {};  // Relative change of the median
+        double low {};  // Confidence interval of the change
+        double high {};
+        Verdict verdict {};
+    };
+
+    struct ResultsFile {
+        std::string host;
+        std::vector<bench::Result> results;
+    };
+
+    // Reads the results back from the file written by Harness::write_json
+    ResultsFile read_json(const std::string& file_path);
+
+    // Differences between machines would show up as regressions and improvements
+    void check_host(const ResultsFile& baseline, const std::string& host);
+
+    // A regression is reported only when the whole confidence interval is above the threshold
+    std::vector<Comparison> compare(
+        const std::vector<bench::Result>& baseline,
+        const std::vector<bench::Result>& current,
+        const Settings& settings
+    );
+
+    // Returns the number of regressions
+    unsigned int print(const std::vector<Comparison>& comparisons, const Settings& settings);
+}
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+
+#include "bench.hpp"
+#include "benchmarks.hpp"
+#include "compare.hpp"
+
+static const char* USAGE {
+    "Usage: muhle_bench [options]\n"
+    "  --filter STRING    only run the benchmarks whose name contains this\n"
+    "  --warmup N         samples thrown away\n"
+    "  --repetitions N    samples kept\n"
+    "  --json PATH        write the results as JSON\n"
+    "  --baseline PATH    compare the results against a JSON baseline recorded on this machine\n"
+    "  --threshold N      slowdown in percent tolerated by the comparison\n"
+    "  --results PATH     compare these JSON results instead of running\n"
+    "Exits with 2 when the comparison finds a regression.\n"
+};
+
+static unsigned int parse_unsigned(const char* value) {
+    std::size_t end {0};
+    const unsigned long result {std::stoul(value, &end)};
+
+    if (value[end] != '\0' || result == 0 || result > 10000) {
+        throw std::invalid_argument(value);
+    }
+
+    return static_cast<unsigned int>(result);
+}
+
+static double parse_percent(const char* value) {
+    std::size_t end {0};
+    const double result {std::stod(value, &end)};
+
+    if (value[end] != '\0' || result < 0.0 || result > 1000.0) {
+        throw std::invalid_argument(value);
+    }
+
+    return result / 100.0;
+}
+
+static void set_echo_variable() {
+#ifdef _WIN32
+    _putenv_s(benchmarks::ECHO_VARIABLE, "1");
+#else
+    setenv(benchmarks::ECHO_VARIABLE, "1", 1);
+#endif
+}
+
+int main(int argc, char** argv) {
+    if (std::getenv(benchmarks::ECHO_VARIABLE) != nullptr) {
+        return benchmarks::echo();
+    }
+
+    bench::Settings settings;
+    compare::Settings compare_settings;
+    std::string json_file_path;
+    std::string baseline_file_path;
+    std::string results_file_path;
+
+    try {
+        for (int i {1}; i < argc; i++) {
+            if (i + 1 == argc) {
+                throw std::invalid_argument(argv[i]);
+            }
+
+            const char* argument {argv[i]};
+            const char* value {argv[++i]};
+
+            if (std::strcmp(argument, "--filter") == 0) {
+                settings.filter = value;
+            } else if (std::strcmp(argument, "--warmup") == 0) {
+                settings.warmup = parse_unsigned(value);
+            } else if (std::strcmp(argument, "--repetitions") == 0) {
+                settings.repetitions = parse_unsigned(value);
+            } else if (std::strcmp(argument, "--json") == 0) {
+                json_file_path = value;
+            } else if (std::strcmp(argument, "--baseline") == 0) {
+                baseline_file_path = value;
+            } else if (std::strcmp(argument, "--threshold") == 0) {
+                compare_settings.threshold = parse_percent(value);
+            } else if (std::strcmp(argument, "--results") == 0) {
+                results_file_path = value;
+            } else {
+                throw std::invalid_argument(argument);
+            }
+        }
+    } catch (const std::logic_error& e) {
+        std::cerr << "Invalid argument " << e.what() << '\n' << USAGE;
+        return 1;
+    }
+
+    if (!results_file_path.empty() && baseline_file_path.empty()) {
+        std::cerr << "--results needs a --baseline\n" << USAGE;
+        return 1;
+    }
+
+    if (!results_file_path.empty()) {
+        try {
+            const auto baseline {compare::read_json(baseline_file_path)};
+            const auto results {compare::read_json(results_file_path)};
+
+            compare::check_host(baseline, results.host);
+
+            const auto comparisons {compare::compare(baseline.results, results.results, compare_settings)};
+
+            return compare::print(comparisons, compare_settings) > 0 ? 2 : 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+#ifndef NDEBUG
+    std::cerr << "Warning: assertions are enabled; build in release mode for meaningful numbers\n";
+#endif
+
+    bench::Harness harness {settings};
+    unsigned int regressions {0};
+
+    try {
+        // Read first, so that a bad path doesn't waste a whole run
+        const auto baseline {
+            baseline_file_path.empty() ? compare::ResultsFile() : compare::read_json(baseline_file_path)
+        };
+
+        if (!baseline_file_path.empty()) {
+            compare::check_host(baseline, bench::host_name());
+        }
+
+        benchmarks::add_board(harness);
+        benchmarks::add_engine(harness);
+
+        // The child process finds the variable in its environment
+        set_echo_variable();
+        benchmarks::add_subprocess(harness, std::filesystem::absolute(argv[0]).string());
+
+        harness.run();
+
+        if (!json_file_path.empty()) {
+            harness.write_json(json_file_path);
+        }
+
+        if (!baseline_file_path.empty()) {
+            regressions = compare::print(compare::compare(baseline.results, harness.get_results(), compare_settings), compare_settings);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return regressions > 0 ? 2 : 0;
+}
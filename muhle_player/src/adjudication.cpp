@@ -0,0 +1,66 @@
+#include "adjudication.hpp"
+
+#include <variant>
+#include <cstdlib>
+
+namespace adjudication {
+    void Adjudicator::reset() {
+        m_score = std::nullopt;
+        m_winner = std::nullopt;
+        m_resign_plies = 0;
+        m_draw_plies = 0;
+    }
+
+    void Adjudicator::update(const engine::Engine::Info& info) {
+        // Secondary lines don't say anything about the move that is played
+        if (!info.score || (info.multipv && *info.multipv != 1)) {
+            return;
+        }
+
+        m_score = info.score;
+    }
+
+    board::GameOver Adjudicator::adjudicate(board::Player player, std::size_t plies) {
+        std::optional<board::Player> winner;
+        bool dead {false};
+
+        // A move without a score breaks both streaks
+        if (m_score) {
+            if (const auto score {std::get_if<engine::Engine::Info::ScoreWin>(&*m_score)}) {
+                if (score->value != 0) {
+                    winner = score->value > 0 ? player : board::Board::opponent(player);
+                }
+            } else {
+                const int value {std::get<engine::Engine::Info::ScoreEval>(*m_score).value};
+
+                if (std::abs(value) > m_settings.resign_score) {
+                    winner = value > 0 ? player : board::Board::opponent(player);
+                }
+
+                dead = std::abs(value) <= m_settings.draw_score && plies >= m_settings.draw_ply;
+            }
+        }
+
+        m_score = std::nullopt;
+
+        // The engines move in turns, so consecutive plies mean that both agree
+        if (winner && winner == m_winner) {
+            m_resign_plies++;
+        } else {
+            m_resign_plies = winner ? 1 : 0;
+        }
+
+        m_winner = winner;
+        m_draw_plies = dead ? m_draw_plies + 1 : 0;
+
+        if (m_settings.resign_moves > 0 && m_resign_plies >= m_settings.resign_moves * 2) {
+            return board::Board::winner(*m_winner);
+        }
+
+        if (m_settings.draw_moves > 0 && m_draw_plies >= m_settings.draw_moves * 2) {
+            return board::GameOver::Draw;
+        }
+
+        return board::GameOver::None;
+    }
+}
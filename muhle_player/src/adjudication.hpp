@@ -0,0 +1,39 @@
+#pragma once
+
+#include <optional>
+#include <cstddef>
+
+#include "board.hpp"
+#include "engine.hpp"
+
+namespace adjudication {
+    // Counted in moves of each engine; zero disables the rule
+    struct Settings {
+        unsigned int resign_moves {0};
+        int resign_score {1000};  // Evaluation beyond which an engine is considered lost
+        unsigned int draw_moves {0};
+        int draw_score {10};  // Evaluation within which the position is considered dead
+        unsigned int draw_ply {60};  // No draws before this ply
+    };
+
+    // Ends engine games early from the scores that the engines report
+    class Adjudicator {
+    public:
+        explicit Adjudicator(const Settings& settings)
+            : m_settings(settings) {}
+
+        void reset();
+
+        // Feed every info message of the engine to move
+        void update(const engine::Engine::Info& info);
+
+        // Call after every move with the player who made it and the plies played so far
+        board::GameOver adjudicate(board::Player player, std::size_t plies);
+    private:
+        Settings m_settings;
+        std::optional<engine::Engine::Info::Score> m_score;  // Of the last search, from the engine's side
+        std::optional<board::Player> m_winner;  // On whom the last scores agree
+        unsigned int m_resign_plies {0};
+        unsigned int m_draw_plies {0};
+    };
+}
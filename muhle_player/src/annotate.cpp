@@ -0,0 +1,200 @@
+#include "annotate.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+
+#include "builtin_engine.hpp"
+#include "loader.hpp"
+
+using namespace std::chrono_literals;
+
+namespace annotate {
+    Annotator::~Annotator() {
+        cancel();
+        finish();
+    }
+
+    void Annotator::start(
+        const std::string& file_path,
+        const Options& options,
+        std::vector<Game>&& games,
+        Limits limits,
+        std::size_t engines
+    ) {
+        assert(m_workers.empty());
+
+        m_file_path = file_path;
+        m_options = options;
+        m_games = std::move(games);
+        m_limits = limits;
+        m_jobs.clear();
+        m_annotations.clear();
+        m_error.clear();
+        m_next_job = 0;
+        m_completed = 0;
+        m_cancelled = false;
+
+        for (std::size_t i {0}; i < m_games.size(); i++) {
+            for (std::size_t ply {1}; ply <= m_games[i].moves.size(); ply++) {
+                m_jobs.push_back({i, ply});
+            }
+        }
+
+        engines = std::max(std::min(engines, m_jobs.size()), std::size_t(1));
+
+        // The engines are created up front, so that they can be interrupted from here
+        for (std::size_t i {0}; i < engines; i++) {
+            auto worker {std::make_unique<Worker>()};
+
+            if (m_file_path.empty()) {
+                worker->engine = std::make_unique<engine::BuiltinEngine>();
+            } else {
+                worker->engine = loader::create_engine(m_file_path);
+            }
+
+            worker->engine->set_wake_callback([this, worker = worker.get()]() {
+                wake(*worker);
+            });
+
+            m_workers.push_back(std::move(worker));
+        }
+
+        m_running = m_workers.size();
+
+        for (const auto& worker : m_workers) {
+            worker->thread = std::thread(&Annotator::task, this, std::ref(*worker));
+        }
+    }
+
+    void Annotator::cancel() {
+        m_cancelled = true;
+
+        // Searching workers wake up and stop their engines themselves
+        for (const auto& worker : m_workers) {
+            worker->engine->interrupt();
+            wake(*worker);
+        }
+    }
+
+    void Annotator::finish() {
+        for (const auto& worker : m_workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+
+        m_workers.clear();
+    }
+
+    std::vector<Annotation> Annotator::poll() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        return std::exchange(m_annotations, {});
+    }
+
+    std::string Annotator::get_error() const {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        return m_error;
+    }
+
+    void Annotator::task(Worker& worker) {
+        engine::Engine& engine {*worker.engine};
+
+        try {
+            loader::initialize_engine(engine, m_file_path);
+
+            for (const auto& [name, value] : m_options) {
+                engine.set_option(name, value);
+            }
+
+            engine.new_game();
+            engine.synchronize();
+
+            while (!m_cancelled) {
+                const std::size_t job {m_next_job++};
+
+                if (job >= m_jobs.size()) {
+                    break;
+                }
+
+                annotate(worker, m_jobs[job]);
+            }
+
+            engine.uninitialize();
+        } catch (const engine::EngineError& e) {
+            std::lock_guard<std::mutex> lock {m_mutex};
+
+            if (m_error.empty() && !m_cancelled) {
+                m_error = e.what();
+            }
+        }
+
+        m_running--;
+
+        if (m_wake_callback) {
+            m_wake_callback();
+        }
+    }
+
+    void Annotator::annotate(Worker& worker, const Job& job) {
+        engine::Engine& engine {*worker.engine};
+        const Game& game {m_games[job.game]};
+
+        Annotation annotation;
+        annotation.game = job.game;
+        annotation.ply = job.ply;
+
+        // Only the main line is kept
+        engine.set_info_callback([&annotation](const engine::Engine::Info& info) {
+            if (!info.multipv || *info.multipv == 1) {
+                search_history::SearchHistory::merge(annotation.entry, info);
+            }
+        });
+
+        const std::vector<std::string> moves(game.moves.begin(), game.moves.begin() + static_cast<std::ptrdiff_t>(job.ply));
+
+        engine.start_thinking(game.position, moves, std::nullopt, std::nullopt, std::nullopt, std::nullopt, m_limits.depth, m_limits.movetime);
+
+        std::optional<std::string> best_move;
+
+        while (!(best_move = engine.done_thinking())) {
+            std::unique_lock<std::mutex> lock {worker.mutex};
+
+            // Engine messages wake up the worker; the timeout is just in case
+            worker.cv.wait_for(lock, 100ms, [&]() { return worker.woken || m_cancelled; });
+            worker.woken = false;
+
+            if (m_cancelled) {
+                lock.unlock();
+                engine.stop_thinking();
+                engine.set_info_callback(nullptr);
+                return;
+            }
+        }
+
+        engine.set_info_callback(nullptr);
+        annotation.best_move = *best_move;
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_annotations.push_back(std::move(annotation));
+        }
+
+        m_completed++;
+
+        if (m_wake_callback) {
+            m_wake_callback();
+        }
+    }
+
+    void Annotator::wake(Worker& worker) {
+        {
+            std::lock_guard<std::mutex> lock {worker.mutex};
+            worker.woken = true;
+        }
+
+        worker.cv.notify_one();
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+#include "engine.hpp"
+#include "search_history.hpp"
+
+namespace annotate {
+    struct Game {
+        std::optional<std::string> position;
+        std::vector<std::string> moves;
+    };
+
+    struct Limits {
+        std::optional<unsigned int> depth;
+        std::optional<unsigned int> movetime;
+    };
+
+    // Evaluation of the position reached after a ply; the score is from the side to move
+    struct Annotation {
+        std::size_t game {};
+        std::size_t ply {};
+        search_history::Entry entry;
+        std::string best_move;
+    };
+
+    // Evaluates every position of some games, using a number of engines in parallel
+    class Annotator {
+    public:
+        Annotator() = default;
+        ~Annotator();
+
+        Annotator(const Annotator&) = delete;
+        Annotator& operator=(const Annotator&) = delete;
+        Annotator(Annotator&&) = delete;
+        Annotator& operator=(Annotator&&) = delete;
+
+        using Options = std::vector<std::pair<std::string, std::optional<std::string>>>;
+
+        // An empty file path means the built-in engine
+        void start(
+            const std::string& file_path,
+            const Options& options,
+            std::vector<Game>&& games,
+            Limits limits,
+            std::size_t engines
+        );
+        void cancel();
+
+        // Join the threads; results not yet polled are still available
+        void finish();
+
+        // Hand over the annotations completed since the last call
+        std::vector<Annotation> poll();
+
+        // Called from the engine threads whenever there is something to poll
+        void set_wake_callback(std::function<void()>&& wake_callback) { m_wake_callback = std::move(wake_callback); }
+
+        bool running() const { return m_running > 0; }
+        std::size_t get_total() const { return m_jobs.size(); }
+        std::size_t get_completed() const { return m_completed.load(); }
+        std::string get_error() const;
+    private:
+        struct Job {
+            std::size_t game;
+            std::size_t ply;
+        };
+
+        struct Worker {
+            std::unique_ptr<engine::Engine> engine;
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool woken {false};
+        };
+
+        void task(Worker& worker);
+        void annotate(Worker& worker, const Job& job);
+        void wake(Worker& worker);
+
+        std::string m_file_path;
+        Options m_options;
+        std::vector<Game> m_games;
+        std::vector<Job> m_jobs;
+        Limits m_limits;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+
+        std::atomic<std::size_t> m_next_job {0};
+        std::atomic<std::size_t> m_completed {0};
+        std::atomic<std::size_t> m_running {0};
+        std::atomic<bool> m_cancelled {false};
+
+        // Filled by the worker threads
+        mutable std::mutex m_mutex;
+        std::vector<Annotation> m_annotations;
+        std::string m_error;
+
+        std::function<void()> m_wake_callback;
+    };
+}
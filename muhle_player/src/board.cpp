@@ -9,6 +9,9 @@
 #include <cstring>
 #include <cassert>
 
+#include "profiler.hpp"
+#include "trace.hpp"
+
 namespace board {
     static constexpr float NODE_RADIUS {2.2f};
 
@@ -259,6 +262,8 @@ namespace board {
     }
 
     void Board::update(bool user_input) {
+        MUHLE_PROFILE_SCOPE("Board::update");
+
         ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
         ImGui::PushStyleVar(ImGuiStyleVar_WindowMinSize, ImVec2(350.0f, 350.0f));
 
@@ -276,54 +281,15 @@ namespace board {
             const float unit {canvas_size.x < canvas_size.y ? (canvas_p1.x - canvas_p0.x) / 10.0f : (canvas_p1.y - canvas_p0.y) / 10.0f};
             const ImVec2 offset {ImVec2(canvas_p0.x, canvas_p0.y)};
 
-            static constexpr ImColor COLOR {ImColor(200, 200, 200)};
-            static constexpr float THICKNESS {2.0f};
-
             m_board_unit = unit;
             m_board_offset = offset;
 
-            draw_list->AddRectFilled(canvas_p0, canvas_p1, ImColor(45, 45, 45));
-
-            draw_list->AddRect(ImVec2(2.0f * unit + offset.x, 8.0f * unit + offset.y), ImVec2(8.0f * unit + offset.x, 2.0f * unit + offset.y), COLOR, 0.0f, 0, THICKNESS);
-            draw_list->AddRect(ImVec2(3.0f * unit + offset.x, 7.0f * unit + offset.y), ImVec2(7.0f * unit + offset.x, 3.0f * unit + offset.y), COLOR, 0.0f, 0, THICKNESS);
-            draw_list->AddRect(ImVec2(4.0f * unit + offset.x, 6.0f * unit + offset.y), ImVec2(6.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, 0.0f, 0, THICKNESS);
-
-            draw_list->AddLine(ImVec2(5.0f * unit + offset.x, 2.0f * unit + offset.y), ImVec2(5.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, THICKNESS);
-            draw_list->AddLine(ImVec2(6.0f * unit + offset.x, 5.0f * unit + offset.y), ImVec2(8.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, THICKNESS);
-            draw_list->AddLine(ImVec2(5.0f * unit + offset.x, 6.0f * unit + offset.y), ImVec2(5.0f * unit + offset.x, 8.0f * unit + offset.y), COLOR, THICKNESS);
-            draw_list->AddLine(ImVec2(2.0f * unit + offset.x, 5.0f * unit + offset.y), ImVec2(4.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, THICKNESS);
-
-            draw_list->AddText(ImVec2(2.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "A");
-            draw_list->AddText(ImVec2(3.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "B");
-            draw_list->AddText(ImVec2(4.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "C");
-            draw_list->AddText(ImVec2(5.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "D");
-            draw_list->AddText(ImVec2(6.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "E");
-            draw_list->AddText(ImVec2(7.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "F");
-            draw_list->AddText(ImVec2(8.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "G");
-
-            draw_list->AddText(ImVec2(2.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "A");
-            draw_list->AddText(ImVec2(3.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "B");
-            draw_list->AddText(ImVec2(4.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "C");
-            draw_list->AddText(ImVec2(5.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "D");
-            draw_list->AddText(ImVec2(6.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "E");
-            draw_list->AddText(ImVec2(7.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "F");
-            draw_list->AddText(ImVec2(8.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "G");
-
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 2.0f * unit + offset.y), COLOR, "7");
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 3.0f * unit + offset.y), COLOR, "6");
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, "5");
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, "4");
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 6.0f * unit + offset.y), COLOR, "3");
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 7.0f * unit + offset.y), COLOR, "2");
-            draw_list->AddText(ImVec2(9.0f * unit + offset.x, 8.0f * unit + offset.y), COLOR, "1");
-
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 2.0f * unit + offset.y), COLOR, "7");
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 3.0f * unit + offset.y), COLOR, "6");
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, "5");
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, "4");
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 6.0f * unit + offset.y), COLOR, "3");
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 7.0f * unit + offset.y), COLOR, "2");
-            draw_list->AddText(ImVec2(1.0f * unit + offset.x, 8.0f * unit + offset.y), COLOR, "1");
+            // The lines and the labels only change with the size of the canvas
+            if (static_layer_valid(draw_list, canvas_size, offset)) {
+                replay_static_layer(draw_list, offset);
+            } else {
+                record_static_layer(draw_list, canvas_size, offset, unit);
+            }
 
             for (PieceObj& piece : m_pieces) {
                 piece.update();
@@ -351,6 +317,130 @@ namespace board {
         ImGui::PopStyleVar(2);
     }
 
+    bool Board::is_animating() const {
+        return std::any_of(m_pieces.cbegin(), m_pieces.cend(), [](const PieceObj& piece) {
+            return piece.is_moving();
+        });
+    }
+
+    void Board::draw_static_layer(ImDrawList* draw_list, ImVec2 canvas_size, ImVec2 offset, float unit) {
+        static constexpr ImColor COLOR {ImColor(200, 200, 200)};
+        static constexpr float THICKNESS {2.0f};
+
+        draw_list->AddRectFilled(offset, ImVec2(offset.x + canvas_size.x, offset.y + canvas_size.y), ImColor(45, 45, 45));
+
+        draw_list->AddRect(ImVec2(2.0f * unit + offset.x, 8.0f * unit + offset.y), ImVec2(8.0f * unit + offset.x, 2.0f * unit + offset.y), COLOR, 0.0f, 0, THICKNESS);
+        draw_list->AddRect(ImVec2(3.0f * unit + offset.x, 7.0f * unit + offset.y), ImVec2(7.0f * unit + offset.x, 3.0f * unit + offset.y), COLOR, 0.0f, 0, THICKNESS);
+        draw_list->AddRect(ImVec2(4.0f * unit + offset.x, 6.0f * unit + offset.y), ImVec2(6.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, 0.0f, 0, THICKNESS);
+
+        draw_list->AddLine(ImVec2(5.0f * unit + offset.x, 2.0f * unit + offset.y), ImVec2(5.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, THICKNESS);
+        draw_list->AddLine(ImVec2(6.0f * unit + offset.x, 5.0f * unit + offset.y), ImVec2(8.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, THICKNESS);
+        draw_list->AddLine(ImVec2(5.0f * unit + offset.x, 6.0f * unit + offset.y), ImVec2(5.0f * unit + offset.x, 8.0f * unit + offset.y), COLOR, THICKNESS);
+        draw_list->AddLine(ImVec2(2.0f * unit + offset.x, 5.0f * unit + offset.y), ImVec2(4.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, THICKNESS);
+
+        draw_list->AddText(ImVec2(2.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "A");
+        draw_list->AddText(ImVec2(3.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "B");
+        draw_list->AddText(ImVec2(4.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "C");
+        draw_list->AddText(ImVec2(5.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "D");
+        draw_list->AddText(ImVec2(6.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "E");
+        draw_list->AddText(ImVec2(7.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "F");
+        draw_list->AddText(ImVec2(8.0f * unit + offset.x, 1.0f * unit + offset.y), COLOR, "G");
+
+        draw_list->AddText(ImVec2(2.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "A");
+        draw_list->AddText(ImVec2(3.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "B");
+        draw_list->AddText(ImVec2(4.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "C");
+        draw_list->AddText(ImVec2(5.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "D");
+        draw_list->AddText(ImVec2(6.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "E");
+        draw_list->AddText(ImVec2(7.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "F");
+        draw_list->AddText(ImVec2(8.0f * unit + offset.x, 9.0f * unit + offset.y), COLOR, "G");
+
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 2.0f * unit + offset.y), COLOR, "7");
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 3.0f * unit + offset.y), COLOR, "6");
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, "5");
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, "4");
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 6.0f * unit + offset.y), COLOR, "3");
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 7.0f * unit + offset.y), COLOR, "2");
+        draw_list->AddText(ImVec2(9.0f * unit + offset.x, 8.0f * unit + offset.y), COLOR, "1");
+
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 2.0f * unit + offset.y), COLOR, "7");
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 3.0f * unit + offset.y), COLOR, "6");
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 4.0f * unit + offset.y), COLOR, "5");
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 5.0f * unit + offset.y), COLOR, "4");
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 6.0f * unit + offset.y), COLOR, "3");
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 7.0f * unit + offset.y), COLOR, "2");
+        draw_list->AddText(ImVec2(1.0f * unit + offset.x, 8.0f * unit + offset.y), COLOR, "1");
+    }
+
+    void Board::record_static_layer(ImDrawList* draw_list, ImVec2 canvas_size, ImVec2 offset, float unit) {
+        const int vertices_begin {draw_list->VtxBuffer.Size};
+        const int indices_begin {draw_list->IdxBuffer.Size};
+        const unsigned int current_index {draw_list->_VtxCurrentIdx};
+
+        draw_static_layer(draw_list, canvas_size, offset, unit);
+
+        m_static_layer.vertices.clear();
+        m_static_layer.indices.clear();
+
+        // Indices are relative to the vertex offset of the command, which may have changed in between
+        if (draw_list->_VtxCurrentIdx - current_index != static_cast<unsigned int>(draw_list->VtxBuffer.Size - vertices_begin)) {
+            return;
+        }
+
+        m_static_layer.vertices.assign(draw_list->VtxBuffer.Data + vertices_begin, draw_list->VtxBuffer.Data + draw_list->VtxBuffer.Size);
+
+        for (int i {indices_begin}; i < draw_list->IdxBuffer.Size; i++) {
+            m_static_layer.indices.push_back(static_cast<ImDrawIdx>(draw_list->IdxBuffer.Data[i] - current_index));
+        }
+
+        const ImVec2 clip_min {draw_list->GetClipRectMin()};
+        const ImVec2 clip_max {draw_list->GetClipRectMax()};
+
+        m_static_layer.canvas_size = canvas_size;
+        m_static_layer.offset = offset;
+        m_static_layer.clip_min = ImVec2(clip_min.x - offset.x, clip_min.y - offset.y);
+        m_static_layer.clip_max = ImVec2(clip_max.x - offset.x, clip_max.y - offset.y);
+    }
+
+    void Board::replay_static_layer(ImDrawList* draw_list, ImVec2 offset) const {
+        const int vertex_count {static_cast<int>(m_static_layer.vertices.size())};
+        const int index_count {static_cast<int>(m_static_layer.indices.size())};
+
+        draw_list->PrimReserve(index_count, vertex_count);
+
+        const unsigned int current_index {draw_list->_VtxCurrentIdx};
+        const float dx {offset.x - m_static_layer.offset.x};
+        const float dy {offset.y - m_static_layer.offset.y};
+
+        for (const ImDrawVert& vertex : m_static_layer.vertices) {
+            ImDrawVert& destination {*draw_list->_VtxWritePtr++};
+            destination = vertex;
+            destination.pos.x += dx;
+            destination.pos.y += dy;
+        }
+
+        for (const ImDrawIdx index : m_static_layer.indices) {
+            *draw_list->_IdxWritePtr++ = static_cast<ImDrawIdx>(current_index + index);
+        }
+
+        draw_list->_VtxCurrentIdx += static_cast<unsigned int>(vertex_count);
+    }
+
+    bool Board::static_layer_valid(const ImDrawList* draw_list, ImVec2 canvas_size, ImVec2 offset) const {
+        if (m_static_layer.vertices.empty()) {
+            return false;
+        }
+
+        // Text is clipped when recorded, so the clipping must be the same
+        const ImVec2 clip_min {draw_list->GetClipRectMin()};
+        const ImVec2 clip_max {draw_list->GetClipRectMax()};
+
+        return (
+            m_static_layer.canvas_size.x == canvas_size.x && m_static_layer.canvas_size.y == canvas_size.y &&
+            m_static_layer.clip_min.x == clip_min.x - offset.x && m_static_layer.clip_min.y == clip_min.y - offset.y &&
+            m_static_layer.clip_max.x == clip_max.x - offset.x && m_static_layer.clip_max.y == clip_max.y - offset.y
+        );
+    }
+
     void Board::debug() const {
         if (ImGui::Begin("Board Internal")) {
             const char* game_over_string {};
@@ -374,7 +464,7 @@ namespace board {
             ImGui::Text("game_over: %s", game_over_string);
             ImGui::Text("plies: %d", m_position.plies);
             ImGui::Text("plies_no_advancement: %d", m_plies_no_advancement);
-            ImGui::Text("positions: %lu", m_positions.size());
+            ImGui::Text("ply: %lu / %lu", m_ply, m_snapshots.size() - 1);
             ImGui::Text("capture_piece: %s", m_capture_piece ? "true" : "false");
             ImGui::Text("select_index: %d", m_select_index);
             ImGui::Text("legal_moves: %lu", m_legal_moves.size());
@@ -390,13 +480,16 @@ namespace board {
     void Board::reset(const Position& position) {
         m_position = position;
         m_plies_no_advancement = 0;
-        m_positions.clear();
 
         m_capture_piece = false;
         m_select_index = -1;
         m_game_over = GameOver::None;
         m_setup_position = m_position;
 
+        m_snapshots.clear();
+        m_snapshots.push_back(make_snapshot());
+        m_ply = 0;
+
         m_legal_moves = generate_moves();
 
         initialize_pieces();
@@ -409,6 +502,10 @@ namespace board {
             throw BoardError("Illegal move");
         }
 
+        if (trace::recording()) {
+            trace::instant("play_move", move_to_string(move));
+        }
+
         switch (move.type) {
             case MoveType::Place:
                 {
@@ -472,6 +569,47 @@ namespace board {
                 m_game_over = GameOver::WinnerWhite;
                 break;
         }
+
+        m_snapshots[m_ply].game_over = m_game_over;
+    }
+
+    void Board::adjudicate(GameOver game_over) {
+        m_game_over = game_over;
+        m_snapshots[m_ply].game_over = m_game_over;
+    }
+
+    void Board::jump(std::size_t ply) {
+        assert(ply < m_snapshots.size());
+
+        const Snapshot& snapshot {m_snapshots[ply]};
+
+        m_position.board = unpack_board(snapshot.board);
+        m_position.player = snapshot.player;
+        m_position.plies = snapshot.plies;
+        m_plies_no_advancement = snapshot.plies_no_advancement;
+        m_game_over = snapshot.game_over;
+        m_ply = ply;
+
+        m_capture_piece = false;
+        m_select_index = -1;
+        m_candidate_moves.clear();
+
+        m_legal_moves = generate_moves();
+
+        initialize_pieces();
+    }
+
+    void Board::take_back() {
+        if (m_ply == 0) {
+            return;
+        }
+
+        jump(m_ply - 1);
+        discard_future();
+    }
+
+    void Board::discard_future() {
+        m_snapshots.resize(m_ply + 1);
     }
 
     void Board::update_user_input() {
@@ -645,6 +783,7 @@ namespace board {
 
         finish_turn();
         check_legal_moves();
+        push_snapshot();
 
         m_move_callback(move);
     }
@@ -660,6 +799,7 @@ namespace board {
         finish_turn();
         check_material();
         check_legal_moves();
+        push_snapshot();
 
         m_move_callback(move);
     }
@@ -675,6 +815,7 @@ namespace board {
         check_legal_moves();
         check_threefold_repetition();
         check_fifty_move_rule();
+        push_snapshot();
 
         m_move_callback(move);
     }
@@ -691,6 +832,7 @@ namespace board {
         finish_turn();
         check_material();
         check_legal_moves();
+        push_snapshot();
 
         m_move_callback(move);
     }
@@ -702,18 +844,22 @@ namespace board {
 
         if (advancement) {
             m_plies_no_advancement = 0;
-            m_positions.clear();
         } else {
             m_plies_no_advancement++;
         }
 
-        // Store the current position anyway
-        m_positions.push_back(m_position);
-
         m_capture_piece = false;
         m_select_index = -1;
     }
 
+    void Board::push_snapshot() {
+        // Playing a move from an earlier ply starts a new line
+        discard_future();
+
+        m_snapshots.push_back(make_snapshot());
+        m_ply++;
+    }
+
     void Board::check_material() {
         if (m_game_over != GameOver::None) {
             return;
@@ -753,17 +899,59 @@ namespace board {
             return;
         }
 
-        const auto count {std::count_if(m_positions.cbegin(), m_positions.cend(), [this](const auto& position) {
-            return position.eq(m_position, m_p);
-        })};
+        if (m_position.plies < m_p) {
+            return;
+        }
+
+        // The current position is not stored yet; only the snapshots since the last advancement can match
+        const auto packed {pack_board(m_position.board)};
+        const auto first {m_ply + 1 - std::min(static_cast<std::size_t>(m_plies_no_advancement), m_ply + 1)};
+        int count {1};
 
-        assert(count >= 1);
+        for (std::size_t i {first}; i <= m_ply; i++) {
+            const Snapshot& snapshot {m_snapshots[i]};
+
+            if (snapshot.board == packed && snapshot.player == m_position.player && snapshot.plies >= m_p) {
+                count++;
+            }
+        }
 
         if (count == 3) {
             m_game_over = GameOver::Draw;
         }
     }
 
+    Snapshot Board::make_snapshot() const {
+        Snapshot snapshot;
+        snapshot.board = pack_board(m_position.board);
+        snapshot.player = m_position.player;
+        snapshot.plies = static_cast<std::uint16_t>(m_position.plies);
+        snapshot.plies_no_advancement = static_cast<std::uint16_t>(m_plies_no_advancement);
+        snapshot.game_over = m_game_over;
+
+        return snapshot;
+    }
+
+    std::uint64_t Board::pack_board(const Board_& board) {
+        std::uint64_t packed {0};
+
+        for (std::size_t i {0}; i < 24; i++) {
+            packed |= static_cast<std::uint64_t>(board[i]) << (i * 2);
+        }
+
+        return packed;
+    }
+
+    Board_ Board::unpack_board(std::uint64_t packed) {
+        Board_ board {};
+
+        for (std::size_t i {0}; i < 24; i++) {
+            board[i] = static_cast<Node>((packed >> (i * 2)) & 3u);
+        }
+
+        return board;
+    }
+
     void Board::initialize_pieces() {
         for (int i {0}; i < 12; i++) {
             m_pieces[i] = PieceObj(Player::White, piece_position_hidden());
@@ -841,19 +1029,45 @@ namespace board {
     }
 
     std::vector<Move> Board::generate_moves() const {
-        Board_ local_board {m_position.board};
+        return generate_moves(m_position, m_p);
+    }
 
-        if (m_position.plies < m_p) {
-            return generate_moves_phase1(local_board, m_position.player, m_p);
+    std::vector<Move> Board::generate_moves(const Position& position, int p) {
+        Board_ local_board {position.board};
+
+        if (position.plies < p) {
+            return generate_moves_phase1(local_board, position.player, p);
         } else {
-            if (count_pieces(local_board, m_position.player) == 3) {
-                return generate_moves_phase3(local_board, m_position.player, m_p);
+            if (count_pieces(local_board, position.player) == 3) {
+                return generate_moves_phase3(local_board, position.player, p);
             } else {
-                return generate_moves_phase2(local_board, m_position.player, m_p);
+                return generate_moves_phase2(local_board, position.player, p);
             }
         }
     }
 
+    void Board::make_move(Position& position, const Move& move) {
+        switch (move.type) {
+            case MoveType::Place:
+                position.board[move.place.place_index] = static_cast<Node>(position.player);
+                break;
+            case MoveType::PlaceCapture:
+                position.board[move.place_capture.place_index] = static_cast<Node>(position.player);
+                position.board[move.place_capture.capture_index] = Node::None;
+                break;
+            case MoveType::Move:
+                std::swap(position.board[move.move.source_index], position.board[move.move.destination_index]);
+                break;
+            case MoveType::MoveCapture:
+                std::swap(position.board[move.move_capture.source_index], position.board[move.move_capture.destination_index]);
+                position.board[move.move_capture.capture_index] = Node::None;
+                break;
+        }
+
+        position.player = opponent(position.player);
+        position.plies++;
+    }
+
     std::vector<Move> Board::generate_moves_phase1(Board_& board, Player player, int p) {
         std::vector<Move> moves;
 
@@ -1385,6 +1599,17 @@ namespace board {
         }
     }
 
+    GameOver Board::winner(Player player) {
+        switch (player) {
+            case Player::White:
+                return GameOver::WinnerWhite;
+            case Player::Black:
+                return GameOver::WinnerBlack;
+        }
+
+        return GameOver::None;
+    }
+
     Move move_from_string(const std::string& string) {
         const auto tokens {split(string, "-x")};
 
@@ -1448,6 +1673,46 @@ namespace board {
         return result;
     }
 
+    // Place moves fit in [0, 24), so they can be stored in a single byte
+    // All other moves fit in 15 bits
+
+    std::uint16_t pack_move(const Move& move) {
+        switch (move.type) {
+            case MoveType::Place:
+                return static_cast<std::uint16_t>(move.place.place_index);
+            case MoveType::PlaceCapture:
+                return static_cast<std::uint16_t>(
+                    24 + move.place_capture.place_index * 24 + move.place_capture.capture_index
+                );
+            case MoveType::Move:
+                return static_cast<std::uint16_t>(
+                    600 + move.move.source_index * 24 + move.move.destination_index
+                );
+            case MoveType::MoveCapture:
+                return static_cast<std::uint16_t>(
+                    1176 + (move.move_capture.source_index * 24 + move.move_capture.destination_index) * 24 + move.move_capture.capture_index
+                );
+        }
+
+        return {};
+    }
+
+    Move unpack_move(std::uint16_t packed) {
+        const int value {packed};
+
+        if (value < 24) {
+            return Move::create_place(value);
+        } else if (value < 600) {
+            return Move::create_place_capture((value - 24) / 24, (value - 24) % 24);
+        } else if (value < 1176) {
+            return Move::create_move((value - 600) / 24, (value - 600) % 24);
+        } else if (value < 1176 + 24 * 24 * 24) {
+            return Move::create_move_capture((value - 1176) / 576, (value - 1176) / 24 % 24, (value - 1176) % 24);
+        }
+
+        throw BoardError("Invalid packed move");
+    }
+
     Position position_from_string(const std::string& string) {
         const std::regex re {R"(^(w|b):(w|b)([a-g][1-7])?(,[a-g][1-7])*:(w|b)([a-g][1-7])?(,[a-g][1-7])*:[0-9]{1,3}$)"};
 
@@ -1494,7 +1759,7 @@ namespace board {
             position.board[index] = static_cast<Node>(pieces2.second);
         }
 
-        position.plies = (turns) - 1 * 2 + static_cast<int>(player == Player::Black);
+        position.plies = (turns - 1) * 2 + static_cast<int>(player == Player::Black);
 
         return position;
     }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <cstddef>
 #include <vector>
 #include <string>
 #include <functional>
@@ -89,6 +91,7 @@ namespace board {
             : m_type(type), m_position(position) {}
 
         Player get_type() const { return m_type; }
+        bool is_moving() const { return m_moving; }
 
         void update();
         void render(ImDrawList* draw_list, float board_unit, ImVec2 board_offset);
@@ -102,6 +105,25 @@ namespace board {
         bool m_moving {false};
     };
 
+    // Lines and labels of the board, recorded from the draw list and copied back every frame
+    struct StaticLayer {
+        ImVec2 canvas_size;
+        ImVec2 offset;
+        ImVec2 clip_min;  // Relative to the offset
+        ImVec2 clip_max;
+        std::vector<ImDrawVert> vertices;
+        std::vector<ImDrawIdx> indices;
+    };
+
+    // Enough to go back to a ply without replaying the game; the board is two bits per node
+    struct Snapshot {
+        std::uint64_t board {};
+        Player player {Player::White};
+        std::uint16_t plies {};
+        std::uint16_t plies_no_advancement {};
+        GameOver game_over {GameOver::None};
+    };
+
     class Board {
     public:
         Board() = default;
@@ -109,7 +131,11 @@ namespace board {
 
         Player get_player() const { return m_position.player; }
         GameOver get_game_over() const { return m_game_over; }
+        bool is_animating() const;
         const Position& get_setup_position() const { return m_setup_position; }
+        const Position& get_position() const { return m_position; }
+        std::size_t get_ply() const { return m_ply; }
+        std::size_t get_plies_played() const { return m_snapshots.size() - 1; }
 
         void update(bool user_input = false);
         void debug() const;
@@ -118,8 +144,28 @@ namespace board {
         void reset(const Position& position);
         void play_move(const Move& move);
         void timeout(Player player);
+
+        // End the game with a result decided outside of the rules
+        void adjudicate(GameOver game_over);
+
+        // Go to any ply played so far; the plies after it are kept until a move is played
+        void jump(std::size_t ply);
+        void take_back();
+        void discard_future();
+
+        // The rules, usable without a board
+        static std::vector<Move> generate_moves(const Position& position, int p);
+        static void make_move(Position& position, const Move& move);
+        static int count_pieces(const Board_& board, Player player);
+        static bool is_mill(const Board_& board, Player player, int index, int p);
+        static Player opponent(Player player);
+        static GameOver winner(Player player);
     private:
         void update_user_input();
+        void draw_static_layer(ImDrawList* draw_list, ImVec2 canvas_size, ImVec2 offset, float unit);
+        void record_static_layer(ImDrawList* draw_list, ImVec2 canvas_size, ImVec2 offset, float unit);
+        void replay_static_layer(ImDrawList* draw_list, ImVec2 offset) const;
+        bool static_layer_valid(const ImDrawList* draw_list, ImVec2 canvas_size, ImVec2 offset) const;
         void select(int index);
         void try_place(int place_index);
         void try_move(int source_index, int destination_index);
@@ -132,11 +178,16 @@ namespace board {
         void play_move_capture_move(const Move& move);
 
         void finish_turn(bool advancement = true);
+        void push_snapshot();
         void check_material();
         void check_legal_moves();
         void check_fifty_move_rule();
         void check_threefold_repetition();
 
+        Snapshot make_snapshot() const;
+        static std::uint64_t pack_board(const Board_& board);
+        static Board_ unpack_board(std::uint64_t packed);
+
         void initialize_pieces();
         int new_piece_to_place(Player type) const;
         int piece_on_node(int index) const;
@@ -154,15 +205,12 @@ namespace board {
         static void unmake_place_move(Board_& board, int place_index);
         static void make_move_move(Board_& board, int source_index, int destination_index);
         static void unmake_move_move(Board_& board, int source_index, int destination_index);
-        static bool is_mill(const Board_& board, Player player, int index, int p);
         static bool is_mill9(const Board_& board, Player player, int index);
         static bool is_mill12(const Board_& board, Player player, int index);
         static bool all_pieces_in_mills(const Board_& board, Player player, int p);
         static std::vector<int> neighbor_free_positions(const Board_& board, int index, int p);
         static std::vector<int> neighbor_free_positions9(const Board_& board, int index);
         static std::vector<int> neighbor_free_positions12(const Board_& board, int index);
-        static int count_pieces(const Board_& board, Player player);
-        static Player opponent(Player player);
 
         // Game mode, number of pieces
         int m_p {NINE};
@@ -170,13 +218,15 @@ namespace board {
         // Game data
         Position m_position;
         int m_plies_no_advancement {};
-        std::vector<Position> m_positions;
+        std::vector<Snapshot> m_snapshots {Snapshot()};  // The first one is the setup position
+        std::size_t m_ply {0};  // Index of the current snapshot
 
         // GUI data
         bool m_capture_piece {false};
         int m_select_index {-1};
         float m_board_unit {};
         ImVec2 m_board_offset;
+        StaticLayer m_static_layer;
         GameOver m_game_over {GameOver::None};
         Position m_setup_position;
         std::array<PieceObj, 24> m_pieces;
@@ -194,6 +244,8 @@ namespace board {
 
     Move move_from_string(const std::string& string);
     std::string move_to_string(const Move& move);
+    std::uint16_t pack_move(const Move& move);
+    Move unpack_move(std::uint16_t packed);
     Position position_from_string(const std::string& string);
     std::string position_to_string(const Position& position);
 }
@@ -0,0 +1,519 @@
+#include "builtin_engine.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <cstdlib>
+
+#include "profiler.hpp"
+#include "trace.hpp"
+
+using namespace std::string_literals;
+
+namespace engine {
+    BuiltinEngine::~BuiltinEngine() {
+        if (m_thread.joinable()) {
+            uninitialize();
+        }
+    }
+
+    void BuiltinEngine::initialize(const std::string&, const std::optional<Capabilities>&) {
+        if (m_thread.joinable()) {
+            throw EngineError("Engine already initialized");
+        }
+
+        m_name = "Muhle Builtin";
+        m_author = "muhle_player";
+        m_options = { Option {"TwelveMensMorris", Option::Check {false}} };
+
+        m_quit = false;
+        m_thread = std::thread(&BuiltinEngine::worker, this);
+    }
+
+    void BuiltinEngine::set_debug(bool) {}
+
+    void BuiltinEngine::synchronize() {
+        // Every command is processed immediately
+    }
+
+    void BuiltinEngine::set_option(const std::string& name, const std::optional<std::string>& value) {
+        if (name == "TwelveMensMorris") {
+            m_p = value && *value == "true" ? board::TWELVE : board::NINE;
+        }
+    }
+
+    void BuiltinEngine::new_game() {
+        stop_thinking();
+
+        m_ponder_move = std::nullopt;
+        m_ponder_time = std::nullopt;
+    }
+
+    void BuiltinEngine::start_thinking(
+        const std::optional<std::string>& position,
+        const std::vector<std::string>& moves,
+        std::optional<unsigned int> wtime,
+        std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc,
+        std::optional<unsigned int> depth,
+        std::optional<unsigned int> movetime
+    ) {
+        auto job {prepare(position, moves)};
+        job.depth = depth;
+        job.time = movetime ? movetime : allocate_time(job.position, wtime, btime, winc, binc);
+
+        start(std::move(job));
+
+        m_go_time = Clock::now();
+    }
+
+    void BuiltinEngine::start_pondering(
+        const std::optional<std::string>& position,
+        const std::vector<std::string>& moves,
+        const std::string& ponder_move,
+        std::optional<unsigned int> wtime,
+        std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc
+    ) {
+        auto all_moves {moves};
+        all_moves.push_back(ponder_move);
+
+        auto job {prepare(position, all_moves)};
+        job.wait_for_stop = true;
+
+        // The clock only starts with the ponder hit
+        m_ponder_time = allocate_time(job.position, wtime, btime, winc, binc);
+
+        start(std::move(job));
+    }
+
+    void BuiltinEngine::start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) {
+        auto job {prepare(position, moves)};
+        job.wait_for_stop = true;
+
+        start(std::move(job));
+    }
+
+    void BuiltinEngine::ponder_hit() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        if (m_ponder_time) {
+            m_deadline = (Clock::now() + std::chrono::milliseconds(*m_ponder_time)).time_since_epoch().count();
+        }
+
+        m_wait_for_stop = false;
+        m_cv.notify_all();
+
+        m_go_time = Clock::now();
+    }
+
+    void BuiltinEngine::stop_thinking() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        // Any event of the current search becomes stale
+        m_generation++;
+        m_job = std::nullopt;
+        m_stop = true;
+        m_cv.notify_all();
+    }
+
+    std::optional<std::string> BuiltinEngine::done_thinking() {
+        MUHLE_PROFILE_SCOPE("done_thinking");
+
+        std::deque<Event> events;
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+
+            for (auto& event : m_events) {
+                if (event.generation == m_generation) {
+                    events.push_back(std::move(event));
+                }
+            }
+
+            m_events.clear();
+        }
+
+        std::optional<std::string> best_move;
+
+        for (const auto& event : events) {
+            switch (event.value.index()) {
+                case 0:
+                    if (m_info_callback) {
+                        m_info_callback(std::get<0>(event.value));
+                    }
+                    break;
+                case 1:
+                    best_move = std::get<1>(event.value).move;
+                    m_ponder_move = std::get<1>(event.value).ponder;
+                    m_best_move_time = event.time;
+                    break;
+            }
+        }
+
+        return best_move;
+    }
+
+    void BuiltinEngine::uninitialize() {
+        m_name.clear();
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+
+            m_quit = true;
+            m_stop = true;
+            m_cv.notify_all();
+        }
+
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    bool BuiltinEngine::alive() {
+        return true;
+    }
+
+    void BuiltinEngine::interrupt() {
+        // Nothing ever blocks
+    }
+
+    void BuiltinEngine::request_stop() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        m_stop = true;
+        m_cv.notify_all();
+    }
+
+    void BuiltinEngine::set_log_output(bool) {}
+
+    void BuiltinEngine::start(Job&& job) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        m_generation++;
+        job.generation = m_generation;
+
+        if (job.time) {
+            m_deadline = (Clock::now() + std::chrono::milliseconds(*job.time)).time_since_epoch().count();
+        } else {
+            m_deadline = 0;
+        }
+
+        m_wait_for_stop = job.wait_for_stop;
+        m_job = std::move(job);
+        m_stop = true;  // Abort the previous search, if any
+        m_cv.notify_all();
+    }
+
+    BuiltinEngine::Job BuiltinEngine::prepare(const std::optional<std::string>& position, const std::vector<std::string>& moves) const {
+        Job job;
+        job.p = m_p;
+
+        if (position) {
+            try {
+                job.position = board::position_from_string(*position);
+            } catch (const board::BoardError& e) {
+                throw EngineError("Invalid position: "s + e.what());
+            }
+        }
+
+        job.positions.push_back(job.position);
+
+        for (const auto& string : moves) {
+            board::Move move;
+
+            try {
+                move = board::move_from_string(string);
+            } catch (const board::BoardError& e) {
+                throw EngineError("Invalid move: "s + e.what());
+            }
+
+            const auto legal_moves {board::Board::generate_moves(job.position, job.p)};
+
+            if (std::find(legal_moves.cbegin(), legal_moves.cend(), move) == legal_moves.cend()) {
+                throw EngineError("Illegal move: " + string);
+            }
+
+            board::Board::make_move(job.position, move);
+
+            // Same bookkeeping as the board
+            if (is_advancement(move)) {
+                job.plies_no_advancement = 0;
+                job.positions.clear();
+            } else {
+                job.plies_no_advancement++;
+            }
+
+            job.positions.push_back(job.position);
+        }
+
+        return job;
+    }
+
+    void BuiltinEngine::worker() {
+        trace::set_thread_name("builtin_engine");
+
+        while (true) {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock {m_mutex};
+
+                m_cv.wait(lock, [this]() { return m_quit || m_job; });
+
+                if (m_quit) {
+                    return;
+                }
+
+                job = std::move(*m_job);
+                m_job = std::nullopt;
+                m_stop = false;
+            }
+
+            search(job);
+        }
+    }
+
+    void BuiltinEngine::search(const Job& job) {
+        trace::Span span {"search"};
+
+        const auto begin {Clock::now()};
+
+        m_search_p = job.p;
+        m_nodes = 0;
+        m_aborted = false;
+        m_path = job.positions;
+        m_root_best_move = std::nullopt;
+
+        board::Position root {job.position};
+        const auto moves {board::Board::generate_moves(root, job.p)};
+
+        const bool game_over {
+            moves.empty() ||
+            (root.plies >= job.p && board::Board::count_pieces(root.board, root.player) < 3) ||
+            job.plies_no_advancement >= 100 ||
+            std::count_if(job.positions.cbegin(), job.positions.cend(), [&](const auto& position) {
+                return position.eq(root, job.p);
+            }) >= 3
+        };
+
+        BestMove best_move;
+
+        if (game_over) {
+            best_move.move = "none";
+        } else {
+            best_move.move = board::move_to_string(moves.front());
+
+            const auto max_depth {std::min(job.depth.value_or(MAX_DEPTH - 1), static_cast<unsigned int>(MAX_DEPTH - 1))};
+
+            for (unsigned int depth {1}; depth <= max_depth; depth++) {
+                const int score {negamax(root, static_cast<int>(depth), 0, -WIN - 1, WIN + 1)};
+
+                if (m_aborted) {
+                    break;
+                }
+
+                const auto elapsed {std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - begin)};
+
+                Info info;
+                info.depth = depth;
+                info.time = static_cast<unsigned int>(elapsed.count());
+                info.nodes = static_cast<unsigned int>(m_nodes);
+
+                if (score >= WIN - MAX_DEPTH) {
+                    info.score = Info::ScoreWin {WIN - score};
+                } else if (score <= -WIN + MAX_DEPTH) {
+                    info.score = Info::ScoreWin {-(WIN + score)};
+                } else {
+                    info.score = Info::ScoreEval {score};
+                }
+
+                std::vector<std::string> pv;
+
+                for (int i {0}; i < m_pv_size[0]; i++) {
+                    pv.push_back(board::move_to_string(m_pv_table[0][i]));
+                }
+
+                m_root_best_move = m_pv_table[0][0];
+                best_move.move = pv.front();
+                best_move.ponder = pv.size() > 1 ? std::make_optional(pv[1]) : std::nullopt;
+
+                info.pv = std::move(pv);
+
+                push_event(job, std::move(info));
+
+                // The result is already known
+                if (std::abs(score) >= WIN - MAX_DEPTH) {
+                    break;
+                }
+
+                // The next iteration is unlikely to finish in time
+                if (job.time && elapsed * 2 > std::chrono::milliseconds(*job.time)) {
+                    break;
+                }
+            }
+        }
+
+        if (job.wait_for_stop) {
+            std::unique_lock<std::mutex> lock {m_mutex};
+
+            m_cv.wait(lock, [this]() { return m_quit || m_stop || !m_wait_for_stop; });
+        }
+
+        push_event(job, std::move(best_move));
+    }
+
+    int BuiltinEngine::negamax(board::Position& position, int depth, int ply, int alpha, int beta) {
+        m_pv_size[ply] = 0;
+        m_nodes++;
+
+        if ((m_nodes & 1023) == 0 && should_stop()) {
+            m_aborted = true;
+        }
+
+        if (m_aborted) {
+            return 0;
+        }
+
+        if (ply > 0) {
+            if (position.plies >= m_search_p && board::Board::count_pieces(position.board, position.player) < 3) {
+                return -(WIN - ply);
+            }
+
+            // Treat any repetition as a draw
+            const auto iter {std::find_if(m_path.cbegin(), m_path.cend(), [&](const auto& other) {
+                return other.eq(position, m_search_p);
+            })};
+
+            if (iter != m_path.cend()) {
+                return 0;
+            }
+        }
+
+        auto moves {board::Board::generate_moves(position, m_search_p)};
+
+        if (moves.empty()) {
+            return -(WIN - ply);
+        }
+
+        if (depth == 0 || ply == MAX_DEPTH - 1) {
+            return evaluate(position, m_search_p);
+        }
+
+        // Best move of the previous iteration first, then captures
+        std::stable_partition(moves.begin(), moves.end(), [](const board::Move& move) {
+            return move.type == board::MoveType::PlaceCapture || move.type == board::MoveType::MoveCapture;
+        });
+
+        if (ply == 0 && m_root_best_move) {
+            const auto iter {std::find(moves.begin(), moves.end(), *m_root_best_move)};
+
+            if (iter != moves.end()) {
+                std::rotate(moves.begin(), iter, std::next(iter));
+            }
+        }
+
+        m_path.push_back(position);
+
+        for (const auto& move : moves) {
+            board::Position child {position};
+            board::Board::make_move(child, move);
+
+            const int score {-negamax(child, depth - 1, ply + 1, -beta, -alpha)};
+
+            if (m_aborted) {
+                break;
+            }
+
+            if (score > alpha) {
+                alpha = score;
+
+                m_pv_table[ply][0] = move;
+                std::copy_n(m_pv_table[ply + 1].cbegin(), m_pv_size[ply + 1], std::next(m_pv_table[ply].begin()));
+                m_pv_size[ply] = m_pv_size[ply + 1] + 1;
+            }
+
+            if (alpha >= beta) {
+                break;
+            }
+        }
+
+        m_path.pop_back();
+
+        return alpha;
+    }
+
+    bool BuiltinEngine::should_stop() {
+        if (m_stop) {
+            return true;
+        }
+
+        const auto deadline {m_deadline.load()};
+
+        return deadline != 0 && Clock::now().time_since_epoch().count() >= deadline;
+    }
+
+    void BuiltinEngine::push_event(const Job& job, std::variant<Info, BestMove>&& value) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        // Don't bother keeping events nobody is waiting for
+        if (job.generation != m_generation) {
+            return;
+        }
+
+        m_events.push_back({job.generation, std::move(value), Clock::now()});
+
+        if (m_wake_callback) {
+            m_wake_callback();
+        }
+    }
+
+    std::optional<unsigned int> BuiltinEngine::allocate_time(
+        const board::Position& position,
+        std::optional<unsigned int> wtime,
+        std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc
+    ) {
+        const auto remaining {position.player == board::Player::White ? wtime : btime};
+        const auto increment {position.player == board::Player::White ? winc : binc};
+
+        if (!remaining) {
+            return std::nullopt;
+        }
+
+        // Most of the increment can be spent, but never more than what's left
+        const unsigned int time {*remaining / 20 + increment.value_or(0) * 3 / 4};
+
+        return std::max(std::min(time, *remaining / 2), 1u);
+    }
+
+    int BuiltinEngine::evaluate(const board::Position& position, int p) {
+        const auto player {position.player};
+        const auto opponent {board::Board::opponent(player)};
+
+        const int material {
+            board::Board::count_pieces(position.board, player) + pieces_in_hand(position, player, p) -
+            board::Board::count_pieces(position.board, opponent) - pieces_in_hand(position, opponent, p)
+        };
+
+        return material * 100;
+    }
+
+    int BuiltinEngine::pieces_in_hand(const board::Position& position, board::Player player, int p) {
+        int result {0};
+
+        // White places on even plies, black on odd plies
+        for (int i {position.plies}; i < p; i++) {
+            result += static_cast<int>((i % 2 == 0) == (player == board::Player::White));
+        }
+
+        return result;
+    }
+
+    bool BuiltinEngine::is_advancement(const board::Move& move) {
+        return move.type != board::MoveType::Move;
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <variant>
+#include <deque>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "engine.hpp"
+#include "board.hpp"
+
+namespace engine {
+    // Alpha-beta engine running in a thread of this process, built on the board move generator
+    class BuiltinEngine : public Engine {
+    public:
+        BuiltinEngine() = default;
+        ~BuiltinEngine() override;
+
+        BuiltinEngine(const BuiltinEngine&) = delete;
+        BuiltinEngine& operator=(const BuiltinEngine&) = delete;
+        BuiltinEngine(BuiltinEngine&&) = delete;
+        BuiltinEngine& operator=(BuiltinEngine&&) = delete;
+
+        // The file path and the capabilities are ignored
+        void initialize(const std::string& file_path, const std::optional<Capabilities>& capabilities) override;
+        void set_debug(bool active) override;
+        void synchronize() override;
+        void set_option(const std::string& name, const std::optional<std::string>& value) override;
+        void new_game() override;
+        void start_thinking(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc,
+            std::optional<unsigned int> depth,
+            std::optional<unsigned int> movetime
+        ) override;
+        void start_pondering(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            const std::string& ponder_move,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc
+        ) override;
+        void start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) override;
+        void ponder_hit() override;
+        void stop_thinking() override;
+        std::optional<std::string> done_thinking() override;
+        void uninitialize() override;
+        bool alive() override;
+        void interrupt() override;
+        void request_stop() override;
+        void set_log_output(bool enable) override;
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Job {
+            board::Position position;
+            int p {};
+            int plies_no_advancement {};
+            std::vector<board::Position> positions;  // Since the last advancement, for repetitions
+            std::optional<unsigned int> depth;
+            std::optional<unsigned int> time;  // Milliseconds; none means until stopped or the maximum depth
+            bool wait_for_stop {false};  // Pondering or infinite
+            unsigned int generation {};
+        };
+
+        struct BestMove {
+            std::string move;
+            std::optional<std::string> ponder;
+        };
+
+        struct Event {
+            unsigned int generation {};
+            std::variant<Info, BestMove> value;
+            Clock::time_point time;
+        };
+
+        static constexpr int MAX_DEPTH {64};
+        static constexpr int WIN {100000};
+
+        void start(Job&& job);
+        Job prepare(const std::optional<std::string>& position, const std::vector<std::string>& moves) const;
+        void worker();
+        void search(const Job& job);
+        int negamax(board::Position& position, int depth, int ply, int alpha, int beta);
+        bool should_stop();
+        void push_event(const Job& job, std::variant<Info, BestMove>&& value);
+
+        static std::optional<unsigned int> allocate_time(
+            const board::Position& position,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc
+        );
+        static int evaluate(const board::Position& position, int p);
+        static int pieces_in_hand(const board::Position& position, board::Player player, int p);
+        static bool is_advancement(const board::Move& move);
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::optional<Job> m_job;
+        std::deque<Event> m_events;
+        unsigned int m_generation {0};
+        bool m_quit {false};
+        bool m_wait_for_stop {false};
+        std::atomic<bool> m_stop {false};
+        std::atomic<Clock::rep> m_deadline {0};  // Zero means no deadline
+
+        // Main thread only
+        int m_p {board::NINE};
+        std::optional<unsigned int> m_ponder_time;
+
+        // Worker thread only
+        int m_search_p {board::NINE};
+        unsigned long long m_nodes {0};
+        bool m_aborted {false};
+        std::vector<board::Position> m_path;
+        std::array<std::array<board::Move, MAX_DEPTH>, MAX_DEPTH> m_pv_table {};
+        std::array<int, MAX_DEPTH> m_pv_size {};
+        std::optional<board::Move> m_root_best_move;
+    };
+}
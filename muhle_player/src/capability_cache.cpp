@@ -0,0 +1,323 @@
+#include "capability_cache.hpp"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <random>
+#include <cstring>
+
+namespace capability_cache {
+    static constexpr char MAGIC[8] {'M', 'U', 'H', 'L', 'E', 'C', 'A', 'P'};
+    static constexpr std::uint32_t VERSION {2};
+    static constexpr std::size_t HASHED_SIZE {65536};
+
+    template<typename T>
+    static void write_value(std::ofstream& stream, T value) {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void write_string(std::ofstream& stream, const std::string& string) {
+        write_value(stream, static_cast<std::uint32_t>(string.size()));
+        stream.write(string.data(), static_cast<std::streamsize>(string.size()));
+    }
+
+    template<typename T>
+    static T read_value(std::ifstream& stream) {
+        T value {};
+        stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+
+        if (!stream) {
+            throw CapabilityCacheError("Unexpected end of file");
+        }
+
+        return value;
+    }
+
+    static std::string read_string(std::ifstream& stream) {
+        const auto size {read_value<std::uint32_t>(stream)};
+
+        if (size > 4096) {
+            throw CapabilityCacheError("String too long");
+        }
+
+        std::string string (size, '\0');
+        stream.read(string.data(), static_cast<std::streamsize>(size));
+
+        if (!stream) {
+            throw CapabilityCacheError("Unexpected end of file");
+        }
+
+        return string;
+    }
+
+    static void write_option(std::ofstream& stream, const engine::Engine::Option& option) {
+        write_string(stream, option.name);
+        write_value(stream, static_cast<std::uint8_t>(option.value.index()));
+
+        switch (option.value.index()) {
+            case 0: {
+                const auto& value {std::get<0>(option.value)};
+                write_value(stream, static_cast<std::uint8_t>(value.default_));
+                break;
+            }
+            case 1: {
+                const auto& value {std::get<1>(option.value)};
+                write_value(stream, static_cast<std::int32_t>(value.default_));
+                write_value(stream, static_cast<std::int32_t>(value.min));
+                write_value(stream, static_cast<std::int32_t>(value.max));
+                break;
+            }
+            case 2: {
+                const auto& value {std::get<2>(option.value)};
+                write_string(stream, value.default_);
+                write_value(stream, static_cast<std::uint32_t>(value.vars.size()));
+                for (const auto& var : value.vars) {
+                    write_string(stream, var);
+                }
+                break;
+            }
+            case 3:
+                break;
+            case 4: {
+                const auto& value {std::get<4>(option.value)};
+                write_string(stream, value.default_);
+                break;
+            }
+        }
+    }
+
+    static engine::Engine::Option read_option(std::ifstream& stream) {
+        engine::Engine::Option option;
+        option.name = read_string(stream);
+
+        switch (read_value<std::uint8_t>(stream)) {
+            case 0: {
+                engine::Engine::Option::Check value;
+                value.default_ = read_value<std::uint8_t>(stream) != 0;
+                option.value = value;
+                break;
+            }
+            case 1: {
+                engine::Engine::Option::Spin value;
+                value.default_ = read_value<std::int32_t>(stream);
+                value.min = read_value<std::int32_t>(stream);
+                value.max = read_value<std::int32_t>(stream);
+                option.value = value;
+                break;
+            }
+            case 2: {
+                engine::Engine::Option::Combo value;
+                value.default_ = read_string(stream);
+                const auto count {read_value<std::uint32_t>(stream)};
+                for (std::uint32_t i {0}; i < count; i++) {
+                    value.vars.push_back(read_string(stream));
+                }
+                option.value = value;
+                break;
+            }
+            case 3:
+                option.value = engine::Engine::Option::Button();
+                break;
+            case 4: {
+                engine::Engine::Option::String value;
+                value.default_ = read_string(stream);
+                option.value = value;
+                break;
+            }
+            default:
+                throw CapabilityCacheError("Invalid option type");
+        }
+
+        return option;
+    }
+
+    bool Identity::operator==(const Identity& other) const {
+        return (
+            file_path == other.file_path &&
+            size == other.size &&
+            modification_time == other.modification_time &&
+            hash == other.hash
+        );
+    }
+
+    void CapabilityCache::load(const std::string& file_path) {
+        m_entries = read_entries(file_path);
+    }
+
+    std::vector<CapabilityCache::Entry> CapabilityCache::read_entries(const std::string& file_path) {
+        std::vector<Entry> entries;
+
+        std::ifstream stream {file_path, std::ios::binary};
+
+        if (!stream.is_open()) {
+            return entries;
+        }
+
+        try {
+            char magic[sizeof(MAGIC)] {};
+            stream.read(magic, sizeof(magic));
+
+            if (!stream || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+                throw CapabilityCacheError("Invalid file");
+            }
+
+            if (read_value<std::uint32_t>(stream) != VERSION) {
+                throw CapabilityCacheError("Invalid version");
+            }
+
+            const auto count {read_value<std::uint32_t>(stream)};
+
+            for (std::uint32_t i {0}; i < count; i++) {
+                Entry entry;
+                entry.identity.file_path = read_string(stream);
+                entry.identity.size = read_value<std::uint64_t>(stream);
+                entry.identity.modification_time = read_value<std::int64_t>(stream);
+                entry.identity.hash = read_value<std::uint64_t>(stream);
+                entry.capabilities.name = read_string(stream);
+                entry.capabilities.author = read_string(stream);
+
+                const auto options {read_value<std::uint32_t>(stream)};
+
+                for (std::uint32_t j {0}; j < options; j++) {
+                    entry.capabilities.options.push_back(read_option(stream));
+                }
+
+                entries.push_back(std::move(entry));
+            }
+        } catch (const CapabilityCacheError&) {
+            entries.clear();
+        }
+
+        return entries;
+    }
+
+    void CapabilityCache::save(const std::string& file_path) {
+        // Other instances may have saved since the load; read the file again just before replacing it
+        for (Entry& entry : read_entries(file_path)) {
+            const bool known {std::any_of(m_entries.cbegin(), m_entries.cend(), [&](const Entry& own_entry) {
+                return own_entry.identity.file_path == entry.identity.file_path;
+            })};
+
+            if (!known) {
+                m_entries.push_back(std::move(entry));
+            }
+        }
+
+        // Write to a temporary file first, so that concurrent readers never see a partial cache
+        // The name is unique, so that concurrent writers don't write into each other's file
+        const std::string temporary_file_path {file_path + ".tmp" + std::to_string(std::random_device()())};
+
+        {
+            std::ofstream stream {temporary_file_path, std::ios::binary | std::ios::trunc};
+
+            if (!stream.is_open()) {
+                throw CapabilityCacheError("Could not open file for writing");
+            }
+
+            stream.write(MAGIC, sizeof(MAGIC));
+            write_value(stream, VERSION);
+            write_value(stream, static_cast<std::uint32_t>(m_entries.size()));
+
+            for (const Entry& entry : m_entries) {
+                write_string(stream, entry.identity.file_path);
+                write_value(stream, entry.identity.size);
+                write_value(stream, entry.identity.modification_time);
+                write_value(stream, entry.identity.hash);
+                write_string(stream, entry.capabilities.name);
+                write_string(stream, entry.capabilities.author);
+                write_value(stream, static_cast<std::uint32_t>(entry.capabilities.options.size()));
+
+                for (const auto& option : entry.capabilities.options) {
+                    write_option(stream, option);
+                }
+            }
+
+            if (!stream) {
+                throw CapabilityCacheError("Could not write to file");
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temporary_file_path, file_path, ec);
+
+        if (ec) {
+            std::error_code remove_ec;
+            std::filesystem::remove(temporary_file_path, remove_ec);
+
+            throw CapabilityCacheError("Could not rename file: " + ec.message());
+        }
+    }
+
+    std::optional<engine::Engine::Capabilities> CapabilityCache::find(const Identity& identity) const {
+        const auto iter {std::find_if(m_entries.cbegin(), m_entries.cend(), [&](const Entry& entry) {
+            return entry.identity == identity;
+        })};
+
+        if (iter == m_entries.cend()) {
+            return std::nullopt;
+        }
+
+        return iter->capabilities;
+    }
+
+    void CapabilityCache::insert(const Identity& identity, const engine::Engine::Capabilities& capabilities) {
+        // Any older build of the same engine is dropped
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) {
+            return entry.identity.file_path == identity.file_path;
+        }), m_entries.end());
+
+        m_entries.push_back({identity, capabilities});
+    }
+
+    Identity CapabilityCache::identify(const std::string& file_path) {
+        Identity identity;
+
+        std::error_code ec;
+
+        const auto path {std::filesystem::canonical(file_path, ec)};
+
+        if (ec) {
+            throw CapabilityCacheError("Could not resolve path: " + ec.message());
+        }
+
+        identity.file_path = path.string();
+
+        identity.size = static_cast<std::uint64_t>(std::filesystem::file_size(path, ec));
+
+        if (ec) {
+            throw CapabilityCacheError("Could not get file size: " + ec.message());
+        }
+
+        identity.modification_time = static_cast<std::int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+
+        if (ec) {
+            throw CapabilityCacheError("Could not get modification time: " + ec.message());
+        }
+
+        // FNV-1a of only the beginning, since hashing a whole engine would cost more than the handshake
+        // Together with the size and the modification time, that's enough to tell builds apart
+        std::ifstream stream {path, std::ios::binary};
+
+        if (!stream.is_open()) {
+            throw CapabilityCacheError("Could not open file for reading");
+        }
+
+        std::uint64_t hash {0xcbf29ce484222325};
+        std::array<char, HASHED_SIZE> buffer;
+
+        stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+        const auto count {static_cast<std::size_t>(stream.gcount())};
+
+        for (std::size_t i {0}; i < count; i++) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 0x100000001b3;
+        }
+
+        identity.hash = hash;
+
+        return identity;
+    }
+}
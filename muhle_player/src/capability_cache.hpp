@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <cstdint>
+
+#include "engine.hpp"
+
+namespace capability_cache {
+    // What makes an engine binary unique
+    struct Identity {
+        std::string file_path;
+        std::uint64_t size {};
+        std::int64_t modification_time {};
+        std::uint64_t hash {};  // Of the beginning of the file
+
+        bool operator==(const Identity& other) const;
+    };
+
+    class CapabilityCache {
+    public:
+        // Missing or invalid files just result in an empty cache
+        void load(const std::string& file_path);
+
+        // Entries saved by other instances since the load are kept
+        void save(const std::string& file_path);
+
+        std::optional<engine::Engine::Capabilities> find(const Identity& identity) const;
+        void insert(const Identity& identity, const engine::Engine::Capabilities& capabilities);
+
+        static Identity identify(const std::string& file_path);
+    private:
+        struct Entry {
+            Identity identity;
+            engine::Engine::Capabilities capabilities;
+        };
+
+        static std::vector<Entry> read_entries(const std::string& file_path);
+
+        std::vector<Entry> m_entries;
+    };
+
+    struct CapabilityCacheError : std::runtime_error {
+        explicit CapabilityCacheError(const char* message)
+            : std::runtime_error(message) {}
+        explicit CapabilityCacheError(const std::string& message)
+            : std::runtime_error(message) {}
+    };
+}
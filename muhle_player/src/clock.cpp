@@ -1,49 +1,82 @@
 #include "clock.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 
 namespace clock_ {
-    void Clock::reset(unsigned int time) {
+    void Clock::reset(const TimeControl& time_control) {
+        m_time_control = time_control;
         m_running = false;
         m_player_white = true;
-        m_white_time = time;
-        m_black_time = time;
+        m_white_time = std::chrono::milliseconds(time_control.time);
+        m_black_time = std::chrono::milliseconds(time_control.time);
+        m_white_moves = 0;
+        m_black_moves = 0;
     }
 
     void Clock::start() {
         m_running = true;
-
-        if (m_player_white) {
-            set_time(m_white_last_time);
-        } else {
-            set_time(m_black_last_time);
-        }
+        m_turn_start = std::chrono::steady_clock::now();
     }
 
     void Clock::stop() {
-        m_running = false;
-    }
-
-    void Clock::update() {
         if (!m_running) {
             return;
         }
 
+        const auto now {std::chrono::steady_clock::now()};
+
+        // Freeze the time without counting a move
         if (m_player_white) {
-            update_time(m_white_time, m_white_last_time);
+            m_white_time = remaining(m_white_time, now);
         } else {
-            update_time(m_black_time, m_black_last_time);
+            m_black_time = remaining(m_black_time, now);
         }
+
+        m_running = false;
     }
 
     void Clock::switch_turn() {
+        switch_turn(std::chrono::steady_clock::now());
+    }
+
+    void Clock::switch_turn(TimePoint time) {
+        if (m_running) {
+            if (m_player_white) {
+                settle(m_white_time, m_white_moves, time);
+            } else {
+                settle(m_black_time, m_black_moves, time);
+            }
+        }
+
         m_player_white = !m_player_white;
+        m_turn_start = std::chrono::steady_clock::now();
+    }
 
-        if (m_player_white) {
-            set_time(m_white_last_time);
-        } else {
-            set_time(m_black_last_time);
+    Clock::Duration Clock::get_white_remaining() const {
+        if (m_running && m_player_white) {
+            return remaining(m_white_time, std::chrono::steady_clock::now());
         }
+
+        return m_white_time;
+    }
+
+    Clock::Duration Clock::get_black_remaining() const {
+        if (m_running && !m_player_white) {
+            return remaining(m_black_time, std::chrono::steady_clock::now());
+        }
+
+        return m_black_time;
+    }
+
+    std::optional<Clock::TimePoint> Clock::get_deadline() const {
+        if (!m_running) {
+            return std::nullopt;
+        }
+
+        const auto time {m_player_white ? m_white_time : m_black_time};
+
+        return m_turn_start + time;
     }
 
     std::tuple<unsigned int, unsigned int, unsigned int> Clock::split_time(unsigned int time) {
@@ -57,21 +90,33 @@ namespace clock_ {
         return std::make_tuple(minutes, seconds, centiseconds);
     }
 
-    void Clock::set_time(std::chrono::steady_clock::time_point& last_time) {
-        last_time = std::chrono::steady_clock::now();
+    Clock::Duration Clock::remaining(Duration time, TimePoint now) const {
+        const Duration elapsed {std::max(now - m_turn_start, Duration::zero())};
+
+        return std::max(time - elapsed, Duration::zero());
     }
 
-    void Clock::update_time(unsigned int& time, std::chrono::steady_clock::time_point& last_time) {
-        const auto now {std::chrono::steady_clock::now()};
+    void Clock::settle(Duration& time, unsigned int& moves, TimePoint until) {
+        time = remaining(time, until);
 
-        auto delta {(now - last_time).count()};
+        // A flagged player doesn't get anything back
+        if (time == Duration::zero()) {
+            return;
+        }
 
-        while ((delta -= 1000 * 1000) >= 0) {
-            if (time > 0) {
-                time -= 1;
-            }
+        moves++;
+
+        const Duration elapsed {std::max(until - m_turn_start, Duration::zero())};
+
+        time += std::min(elapsed, Duration(std::chrono::milliseconds(m_time_control.delay)));
+        time += std::chrono::milliseconds(m_time_control.increment);
+
+        if (m_time_control.moves > 0 && moves % m_time_control.moves == 0) {
+            time += std::chrono::milliseconds(m_time_control.time);
         }
+    }
 
-        last_time = now;
+    unsigned int Clock::to_milliseconds(Duration time) {
+        return static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::milliseconds>(time).count());
     }
 }
@@ -2,29 +2,58 @@
 
 #include <chrono>
 #include <tuple>
+#include <optional>
 
 namespace clock_ {
+    struct TimeControl {
+        unsigned int time {1000 * 60 * 3};
+        unsigned int increment {0};  // Fischer; added after every move
+        unsigned int delay {0};  // Bronstein; the time used, up to this much, is given back after the move
+        unsigned int moves {0};  // The time is added again after this many moves; zero means never
+    };
+
+    // Remaining time is computed from the start of the turn, so nothing needs to be updated periodically
     class Clock {
     public:
-        void reset(unsigned int time = 1000 * 60 * 3);
+        using TimePoint = std::chrono::steady_clock::time_point;
+        using Duration = std::chrono::nanoseconds;
+
+        void reset(const TimeControl& time_control = {});
         void start();
         void stop();
-        void update();
         void switch_turn();
 
-        unsigned int get_white_time() const { return m_white_time; }
-        unsigned int get_black_time() const { return m_black_time; }
+        // Charge the player who moved only up to the given time, which may be in the past
+        void switch_turn(TimePoint time);
+
+        unsigned int get_white_time() const { return to_milliseconds(get_white_remaining()); }
+        unsigned int get_black_time() const { return to_milliseconds(get_black_remaining()); }
+        Duration get_white_remaining() const;
+        Duration get_black_remaining() const;
+        unsigned int get_increment() const { return m_time_control.increment; }
+
+        // The delay gives back what a move used, up to its length, which to an engine is like an increment
+        unsigned int get_engine_increment() const { return m_time_control.increment + m_time_control.delay; }
+        const TimeControl& get_time_control() const { return m_time_control; }
+        bool is_running() const { return m_running; }
+        bool is_player_white() const { return m_player_white; }
+
+        // When the player to move runs out of time, if the clock is running
+        std::optional<TimePoint> get_deadline() const;
 
         static std::tuple<unsigned int, unsigned int, unsigned int> split_time(unsigned int time);
     private:
-        static void set_time(std::chrono::steady_clock::time_point& last_time);
-        static void update_time(unsigned int& time, std::chrono::steady_clock::time_point& last_time);
+        Duration remaining(Duration time, TimePoint now) const;
+        void settle(Duration& time, unsigned int& moves, TimePoint until);
+        static unsigned int to_milliseconds(Duration time);
 
+        TimeControl m_time_control;
         bool m_running {false};
         bool m_player_white {true};
-        unsigned int m_white_time {1000 * 60 * 3};
-        unsigned int m_black_time {1000 * 60 * 3};
-        std::chrono::steady_clock::time_point m_white_last_time {};
-        std::chrono::steady_clock::time_point m_black_last_time {};
+        Duration m_white_time {std::chrono::minutes(3)};
+        Duration m_black_time {std::chrono::minutes(3)};
+        unsigned int m_white_moves {0};
+        unsigned int m_black_moves {0};
+        TimePoint m_turn_start {};
     };
 }
@@ -6,11 +6,21 @@
 #include <utility>
 #include <cstring>
 
+#include "profiler.hpp"
+
 using namespace std::string_literals;
 using namespace std::chrono_literals;
 
 namespace engine {
-    void Engine::initialize(const std::string& file_path) {
+    void SubprocessEngine::initialize(const std::string& file_path, const std::optional<Capabilities>& capabilities) {
+        if (capabilities) {
+            m_name = capabilities->name;
+            m_author = capabilities->author;
+            m_options = capabilities->options;
+        }
+
+        m_subprocess.set_read_callback(m_wake_callback);
+
         try {
             m_subprocess.open(file_path);
         } catch (const subprocess::SubprocessError& e) {
@@ -23,24 +33,22 @@ namespace engine {
             throw EngineError("Could not write to subprocess: "s + e.what());
         }
 
-        const auto begin {std::chrono::steady_clock::now()};
+        const auto deadline {std::chrono::steady_clock::now() + 5s};
 
         while (true) {
-            const auto now {std::chrono::steady_clock::now()};
-
-            if (now - begin > 5s) {
-                throw EngineError("Engine did not respond in a timely manner");
-            }
-
             std::string message;
 
             try {
-                message = m_subprocess.read_line();
+                message = m_subprocess.read_line(deadline);
             } catch (const subprocess::SubprocessError& e) {
                 throw EngineError("Could not read from subprocess: "s + e.what());
             }
 
             if (message.empty()) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    throw EngineError("Engine did not respond in a timely manner");
+                }
+
                 continue;
             }
 
@@ -49,6 +57,11 @@ namespace engine {
                 m_log_output_stream.flush();
             }
 
+            // Everything is already known; just wait for the engine to finish talking
+            if (capabilities && message.compare(0, 6, "gbgpok") != 0) {
+                continue;
+            }
+
             const auto tokens {parse_message(message)};
 
             if (tokens.empty()) {
@@ -83,7 +96,7 @@ namespace engine {
         }
     }
 
-    void Engine::set_debug(bool active) {
+    void SubprocessEngine::set_debug(bool active) {
         try {
             m_subprocess.write_line("debug"s + (active ? " on" : " off"));
         } catch (const subprocess::SubprocessError& e) {
@@ -91,31 +104,29 @@ namespace engine {
         }
     }
 
-    void Engine::synchronize() {
+    void SubprocessEngine::synchronize() {
         try {
             m_subprocess.write_line("isready");
         } catch (const subprocess::SubprocessError& e) {
             throw EngineError("Could not write to subprocess: "s + e.what());
         }
 
-        const auto begin {std::chrono::steady_clock::now()};
+        const auto deadline {std::chrono::steady_clock::now() + 5s};
 
         while (true) {
-            const auto now {std::chrono::steady_clock::now()};
-
-            if (now - begin > 5s) {
-                throw EngineError("Engine did not respond in a timely manner");
-            }
-
             std::string message;
 
             try {
-                message = m_subprocess.read_line();
+                message = m_subprocess.read_line(deadline);
             } catch (const subprocess::SubprocessError& e) {
                 throw EngineError("Could not read from subprocess: "s + e.what());
             }
 
             if (message.empty()) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    throw EngineError("Engine did not respond in a timely manner");
+                }
+
                 continue;
             }
 
@@ -132,11 +143,15 @@ namespace engine {
 
             if (tokens[0] == "readyok") {
                 break;
+            } else if (tokens[0] == "bestmove") {
+                if (m_stale_best_moves > 0) {
+                    m_stale_best_moves--;
+                }
             }
         }
     }
 
-    void Engine::set_option(const std::string& name, const std::optional<std::string>& value) {
+    void SubprocessEngine::set_option(const std::string& name, const std::optional<std::string>& value) {
         try {
             m_subprocess.write_line("setoption name " + name + (value ? " value " + *value : ""));
         } catch (const subprocess::SubprocessError& e) {
@@ -144,97 +159,189 @@ namespace engine {
         }
     }
 
-    void Engine::new_game() {
+    void SubprocessEngine::new_game() {
         try {
             m_subprocess.write_line("newgame");
         } catch (const subprocess::SubprocessError& e) {
             throw EngineError("Could not write to subprocess: "s + e.what());
         }
+
+        m_ponder_move.reset();
+        m_expected_reply.reset();
     }
 
-    void Engine::start_thinking(
+    void SubprocessEngine::start_thinking(
         const std::optional<std::string>& position,
         const std::vector<std::string>& moves,
         std::optional<unsigned int> wtime,
         std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc,
         std::optional<unsigned int> depth,
         std::optional<unsigned int> movetime
     ) {
-        const auto moves_str {
-            !moves.empty()
-            ?
-            " moves " + std::accumulate(++moves.cbegin(), moves.cend(), *moves.cbegin(), [](std::string r, const std::string& move) {
-                return std::move(r) + " " + move;
-            })
-            :
-            ""
-        };
+        write_position(position, moves);
 
         try {
-            m_subprocess.write_line("position" + (position ? " pos " + *position : " startpos") + moves_str);
+            m_subprocess.write_line(
+                "go"s +
+                (wtime ? " wtime " + std::to_string(*wtime) : "") +
+                (btime ? " btime " + std::to_string(*btime) : "") +
+                (winc ? " winc " + std::to_string(*winc) : "") +
+                (binc ? " binc " + std::to_string(*binc) : "") +
+                (depth ? " depth " + std::to_string(*depth) : "") +
+                (movetime ? " movetime " + std::to_string(*movetime) : "")
+            );
         } catch (const subprocess::SubprocessError& e) {
             throw EngineError("Could not write to subprocess: "s + e.what());
         }
 
+        m_go_time = std::chrono::steady_clock::now();
+        m_thinking = true;
+        m_ponder_move.reset();
+    }
+
+    void SubprocessEngine::start_pondering(
+        const std::optional<std::string>& position,
+        const std::vector<std::string>& moves,
+        const std::string& ponder_move,
+        std::optional<unsigned int> wtime,
+        std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc
+    ) {
+        auto ponder_moves {moves};
+        ponder_moves.push_back(ponder_move);
+
+        write_position(position, ponder_moves);
+
         try {
             m_subprocess.write_line(
-                "go"s +
+                "go ponder"s +
                 (wtime ? " wtime " + std::to_string(*wtime) : "") +
                 (btime ? " btime " + std::to_string(*btime) : "") +
-                (depth ? " depth " + std::to_string(*depth) : "") +
-                (movetime ? " movetime " + std::to_string(*movetime) : "")
+                (winc ? " winc " + std::to_string(*winc) : "") +
+                (binc ? " binc " + std::to_string(*binc) : "")
             );
         } catch (const subprocess::SubprocessError& e) {
             throw EngineError("Could not write to subprocess: "s + e.what());
         }
+
+        m_thinking = true;
+        m_ponder_move.reset();
     }
 
-    void Engine::stop_thinking() {
+    void SubprocessEngine::start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) {
+        write_position(position, moves);
+
         try {
-            m_subprocess.write_line("stop");
+            m_subprocess.write_line("go infinite");
         } catch (const subprocess::SubprocessError& e) {
             throw EngineError("Could not write to subprocess: "s + e.what());
         }
-    }
 
-    std::optional<std::string> Engine::done_thinking() {
-        std::string message;
+        m_thinking = true;
+        m_ponder_move.reset();
+    }
 
+    void SubprocessEngine::ponder_hit() {
         try {
-            message = m_subprocess.read_line();
+            m_subprocess.write_line("ponderhit");
         } catch (const subprocess::SubprocessError& e) {
-            throw EngineError("Could not read from subprocess: "s + e.what());
+            throw EngineError("Could not write to subprocess: "s + e.what());
         }
 
-        if (message.empty()) {
-            return std::nullopt;
+        m_go_time = std::chrono::steady_clock::now();
+    }
+
+    void SubprocessEngine::stop_thinking() {
+        try {
+            m_subprocess.write_line("stop");
+        } catch (const subprocess::SubprocessError& e) {
+            throw EngineError("Could not write to subprocess: "s + e.what());
         }
 
-        if (m_log_output_stream.is_open()) {
-            m_log_output_stream << message << '\n';
-            m_log_output_stream.flush();
+        // The engine still replies with a best move, which is now stale
+        if (m_thinking) {
+            m_thinking = false;
+            m_stale_best_moves++;
         }
+    }
 
-        const auto tokens {parse_message(message)};
+    std::optional<std::string> SubprocessEngine::done_thinking() {
+        MUHLE_PROFILE_SCOPE("done_thinking");
 
-        if (tokens.empty()) {
-            return std::nullopt;
-        }
+        // Drain everything that has arrived since the last call, so that bursts of info messages
+        // don't pile up in the queue; only flush the log once at the end
+        std::optional<std::string> best_move;
+
+        while (!best_move) {
+            std::string message;
+
+            try {
+                message = m_subprocess.read_line();
+            } catch (const subprocess::SubprocessError& e) {
+                throw EngineError("Could not read from subprocess: "s + e.what());
+            }
+
+            if (message.empty()) {
+                break;
+            }
 
-        if (tokens[0] == "bestmove") {
-            if (token_available(tokens, 1)) {
-                return tokens[1];
+            if (m_log_output_stream.is_open()) {
+                m_log_output_stream << message << '\n';
             }
-        } else if (tokens[0] == "info") {
-            if (m_info_callback) {
-                m_info_callback(parse_info(tokens));
+
+            const auto tokens {parse_message(message)};
+
+            if (tokens.empty()) {
+                continue;
+            }
+
+            if (tokens[0] == "bestmove") {
+                if (m_stale_best_moves > 0) {
+                    m_stale_best_moves--;
+                    continue;
+                }
+
+                m_thinking = false;
+                m_best_move_time = m_subprocess.last_read_time();
+
+                if (token_available(tokens, 1)) {
+                    best_move = tokens[1];
+                }
+
+                if (token_available(tokens, 3) && tokens[2] == "ponder") {
+                    m_ponder_move = tokens[3];
+                } else {
+                    m_ponder_move = m_expected_reply;
+                }
+            } else if (tokens[0] == "info") {
+                // Everything before a stale best move belongs to the stopped search
+                if (m_stale_best_moves > 0) {
+                    continue;
+                }
+
+                const auto info {parse_info(tokens)};
+
+                if (info.pv && info.pv->size() > 1) {
+                    m_expected_reply = (*info.pv)[1];
+                }
+
+                if (m_info_callback) {
+                    m_info_callback(info);
+                }
             }
         }
 
-        return std::nullopt;
+        if (m_log_output_stream.is_open()) {
+            m_log_output_stream.flush();
+        }
+
+        return best_move;
     }
 
-    void Engine::uninitialize() {
+    void SubprocessEngine::uninitialize() {
         m_name.clear();
 
         try {
@@ -250,11 +357,44 @@ namespace engine {
         }
     }
 
+    bool SubprocessEngine::alive() {
+        try {
+            return m_subprocess.alive();
+        } catch (const subprocess::SubprocessError& e) {
+            throw EngineError("Could not query subprocess: "s + e.what());
+        }
+    }
+
+    void SubprocessEngine::interrupt() {
+        m_subprocess.interrupt();
+    }
+
+    void SubprocessEngine::request_stop() {
+        try {
+            m_subprocess.write_line("stop");
+        } catch (const subprocess::SubprocessError&) {
+            // The error shows up again on the main thread
+        }
+    }
+
     void Engine::set_info_callback(std::function<void(const Info&)>&& info_callback) {
         m_info_callback = std::move(info_callback);
     }
 
-    void Engine::set_log_output(bool enable) {
+    void Engine::set_wake_callback(std::function<void()>&& wake_callback) {
+        m_wake_callback = std::move(wake_callback);
+    }
+
+    Engine::Capabilities Engine::get_capabilities() const {
+        Capabilities capabilities;
+        capabilities.name = m_name;
+        capabilities.author = m_author;
+        capabilities.options = m_options;
+
+        return capabilities;
+    }
+
+    void SubprocessEngine::set_log_output(bool enable) {
         if (enable) {
             m_log_output_stream.open("muhle_player.log", std::ios::app);
         } else {
@@ -262,7 +402,27 @@ namespace engine {
         }
     }
 
-    std::vector<std::string> Engine::parse_message(const std::string& message) {
+    void SubprocessEngine::write_position(const std::optional<std::string>& position, const std::vector<std::string>& moves) {
+        const auto moves_str {
+            !moves.empty()
+            ?
+            " moves " + std::accumulate(++moves.cbegin(), moves.cend(), *moves.cbegin(), [](std::string r, const std::string& move) {
+                return std::move(r) + " " + move;
+            })
+            :
+            ""
+        };
+
+        m_expected_reply.reset();
+
+        try {
+            m_subprocess.write_line("position" + (position ? " pos " + *position : " startpos") + moves_str);
+        } catch (const subprocess::SubprocessError& e) {
+            throw EngineError("Could not write to subprocess: "s + e.what());
+        }
+    }
+
+    std::vector<std::string> SubprocessEngine::parse_message(const std::string& message) {
         std::vector<std::string> tokens;
         std::string buffer {message};
 
@@ -280,7 +440,7 @@ namespace engine {
         return tokens;
     }
 
-    std::optional<Engine::Option> Engine::parse_option(const std::vector<std::string>& tokens) {
+    std::optional<Engine::Option> SubprocessEngine::parse_option(const std::vector<std::string>& tokens) {
         Option option;
 
         const auto name {parse_option_name(tokens)};
@@ -364,7 +524,7 @@ namespace engine {
         return option;
     }
 
-    std::optional<std::string> Engine::parse_option_name(const std::vector<std::string>& tokens) {
+    std::optional<std::string> SubprocessEngine::parse_option_name(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "name")};
 
         if (iter == tokens.cend()) {
@@ -388,7 +548,7 @@ namespace engine {
         return name.substr(1);
     }
 
-    std::optional<std::string> Engine::parse_option_type(const std::vector<std::string>& tokens) {
+    std::optional<std::string> SubprocessEngine::parse_option_type(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "type")};
 
         if (iter == tokens.cend()) {
@@ -402,7 +562,7 @@ namespace engine {
         return std::nullopt;
     }
 
-    std::optional<std::string> Engine::parse_option_default(const std::vector<std::string>& tokens) {
+    std::optional<std::string> SubprocessEngine::parse_option_default(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "default")};
 
         if (iter == tokens.cend()) {
@@ -426,7 +586,7 @@ namespace engine {
         return default_.substr(1);
     }
 
-    std::optional<int> Engine::parse_option_min(const std::vector<std::string>& tokens) {
+    std::optional<int> SubprocessEngine::parse_option_min(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "min")};
 
         if (iter == tokens.cend()) {
@@ -444,7 +604,7 @@ namespace engine {
         return std::nullopt;
     }
 
-    std::optional<int> Engine::parse_option_max(const std::vector<std::string>& tokens) {
+    std::optional<int> SubprocessEngine::parse_option_max(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "max")};
 
         if (iter == tokens.cend()) {
@@ -462,7 +622,7 @@ namespace engine {
         return std::nullopt;
     }
 
-    std::optional<std::vector<std::string>> Engine::parse_option_vars(const std::vector<std::string>& tokens) {
+    std::optional<std::vector<std::string>> SubprocessEngine::parse_option_vars(const std::vector<std::string>& tokens) {
         std::vector<std::string>::const_iterator iter {tokens.cbegin()};
         std::vector<std::string> vars;
 
@@ -493,18 +653,19 @@ namespace engine {
         return vars;
     }
 
-    Engine::Info Engine::parse_info(const std::vector<std::string>& tokens) {
+    Engine::Info SubprocessEngine::parse_info(const std::vector<std::string>& tokens) {
         Info info;
         info.depth = parse_info_ui(tokens, "depth");
         info.time = parse_info_ui(tokens, "time");
         info.nodes = parse_info_ui(tokens, "nodes");
+        info.multipv = parse_info_ui(tokens, "multipv");
         info.score = parse_info_score(tokens);
         info.pv = parse_info_pv(tokens);
 
         return info;
     }
 
-    std::optional<unsigned int> Engine::parse_info_ui(const std::vector<std::string>& tokens, const std::string& name) {
+    std::optional<unsigned int> SubprocessEngine::parse_info_ui(const std::vector<std::string>& tokens, const std::string& name) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), name)};
 
         if (iter == tokens.cend()) {
@@ -522,7 +683,7 @@ namespace engine {
         return std::nullopt;
     }
 
-    std::optional<Engine::Info::Score> Engine::parse_info_score(const std::vector<std::string>& tokens) {
+    std::optional<Engine::Info::Score> SubprocessEngine::parse_info_score(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "score")};
 
         if (iter == tokens.cend()) {
@@ -554,7 +715,7 @@ namespace engine {
         return std::nullopt;
     }
 
-    std::optional<std::vector<std::string>> Engine::parse_info_pv(const std::vector<std::string>& tokens) {
+    std::optional<std::vector<std::string>> SubprocessEngine::parse_info_pv(const std::vector<std::string>& tokens) {
         auto iter {std::find(tokens.cbegin(), tokens.cend(), "pv")};
 
         if (iter == tokens.cend()) {
@@ -570,7 +731,7 @@ namespace engine {
         return pv;
     }
 
-    bool Engine::token_available(const std::vector<std::string>& tokens, std::size_t index) {
+    bool SubprocessEngine::token_available(const std::vector<std::string>& tokens, std::size_t index) {
         return index < tokens.size();
     }
 }
@@ -7,6 +7,7 @@
 #include <functional>
 #include <variant>
 #include <fstream>
+#include <chrono>
 
 #include "subprocess.hpp"
 
@@ -22,6 +23,7 @@ namespace engine {
             std::optional<unsigned int> depth;
             std::optional<unsigned int> time;
             std::optional<unsigned int> nodes;
+            std::optional<unsigned int> multipv;
             std::optional<Score> score;
             std::optional<std::vector<std::string>> pv;
         };
@@ -54,30 +56,127 @@ namespace engine {
             Value value;
         };
 
-        void initialize(const std::string& file_path);
-        void set_debug(bool active);
-        void synchronize();
-        void set_option(const std::string& name, const std::optional<std::string>& value);
-        void new_game();
-        void start_thinking(
+        // Everything the engine tells about itself during the handshake
+        struct Capabilities {
+            std::string name;
+            std::string author;
+            std::vector<Option> options;
+        };
+
+        virtual ~Engine() = default;
+
+        // Known capabilities skip parsing the handshake
+        virtual void initialize(const std::string& file_path, const std::optional<Capabilities>& capabilities) = 0;
+        virtual void set_debug(bool active) = 0;
+        virtual void synchronize() = 0;
+        virtual void set_option(const std::string& name, const std::optional<std::string>& value) = 0;
+        virtual void new_game() = 0;
+        virtual void start_thinking(
             const std::optional<std::string>& position,
             const std::vector<std::string>& moves,
             std::optional<unsigned int> wtime,
             std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc,
             std::optional<unsigned int> depth,
             std::optional<unsigned int> movetime
-        );
-        void stop_thinking();
-        std::optional<std::string> done_thinking();
-        void uninitialize();
+        ) = 0;
+        virtual void start_pondering(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            const std::string& ponder_move,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc
+        ) = 0;
+        virtual void start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) = 0;
+        virtual void ponder_hit() = 0;
+
+        // The best move of a stopped search is discarded
+        virtual void stop_thinking() = 0;
+        virtual std::optional<std::string> done_thinking() = 0;
+        virtual void uninitialize() = 0;
+        virtual bool alive() = 0;
+
+        // Abort a blocking initialize or synchronize; can be called from any thread
+        virtual void interrupt() = 0;
+
+        // Make the current search end as soon as possible; can be called from any thread
+        // Unlike stop_thinking, the best move is still delivered
+        virtual void request_stop() = 0;
+
+        virtual void set_log_output(bool enable) = 0;
 
         void set_info_callback(std::function<void(const Info&)>&& info_callback);
-        void set_log_output(bool enable);
+
+        // Called from any thread whenever new messages arrive; must be set before initialize
+        void set_wake_callback(std::function<void()>&& wake_callback);
         const std::string& get_name() const { return m_name; }
         const std::string& get_author() const { return m_author; }
         const std::vector<Option>& get_options() const { return m_options; }
-    private:
+        Capabilities get_capabilities() const;
+
+        // The expected reply to the last best move, either from the engine or from its last PV
+        const std::optional<std::string>& get_ponder_move() const { return m_ponder_move; }
+
+        // When the engine's clock was last started, and when its last best move was received
+        std::chrono::steady_clock::time_point get_go_time() const { return m_go_time; }
+        std::chrono::steady_clock::time_point get_best_move_time() const { return m_best_move_time; }
+    protected:
+        std::function<void(const Info&)> m_info_callback;
+        std::function<void()> m_wake_callback;
+        std::string m_name;
+        std::string m_author;
+        std::vector<Option> m_options;
+        std::optional<std::string> m_ponder_move;
+        std::chrono::steady_clock::time_point m_go_time {};
+        std::chrono::steady_clock::time_point m_best_move_time {};
+    };
+
+    // Engine running in a separate process, talking through pipes
+    class SubprocessEngine : public Engine {
+    public:
+        void initialize(const std::string& file_path, const std::optional<Capabilities>& capabilities) override;
+        void set_debug(bool active) override;
+        void synchronize() override;
+        void set_option(const std::string& name, const std::optional<std::string>& value) override;
+        void new_game() override;
+        void start_thinking(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc,
+            std::optional<unsigned int> depth,
+            std::optional<unsigned int> movetime
+        ) override;
+        void start_pondering(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            const std::string& ponder_move,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc
+        ) override;
+        void start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) override;
+        void ponder_hit() override;
+        void stop_thinking() override;
+        std::optional<std::string> done_thinking() override;
+        void uninitialize() override;
+        bool alive() override;
+        void interrupt() override;
+        void request_stop() override;
+        void set_log_output(bool enable) override;
+
+        // The protocol, usable without a process
         static std::vector<std::string> parse_message(const std::string& message);
+        static Info parse_info(const std::vector<std::string>& tokens);
+    private:
+        void write_position(const std::optional<std::string>& position, const std::vector<std::string>& moves);
+
         static std::optional<Option> parse_option(const std::vector<std::string>& tokens);
         static std::optional<std::string> parse_option_name(const std::vector<std::string>& tokens);
         static std::optional<std::string> parse_option_type(const std::vector<std::string>& tokens);
@@ -85,18 +184,17 @@ namespace engine {
         static std::optional<int> parse_option_min(const std::vector<std::string>& tokens);
         static std::optional<int> parse_option_max(const std::vector<std::string>& tokens);
         static std::optional<std::vector<std::string>> parse_option_vars(const std::vector<std::string>& tokens);
-        static Info parse_info(const std::vector<std::string>& tokens);
         static std::optional<unsigned int> parse_info_ui(const std::vector<std::string>& tokens, const std::string& name);
         static std::optional<Info::Score> parse_info_score(const std::vector<std::string>& tokens);
         static std::optional<std::vector<std::string>> parse_info_pv(const std::vector<std::string>& tokens);
         static bool token_available(const std::vector<std::string>& tokens, std::size_t index);
 
         subprocess::Subprocess m_subprocess;
-        std::function<void(const Info&)> m_info_callback;
         std::ofstream m_log_output_stream;
-        std::string m_name;
-        std::string m_author;
-        std::vector<Option> m_options;
+
+        bool m_thinking {false};
+        unsigned int m_stale_best_moves {0};
+        std::optional<std::string> m_expected_reply;
     };
 
     struct EngineError : std::runtime_error {
@@ -0,0 +1,109 @@
+#ifndef MUHLE_ENGINE_PLUGIN_H
+#define MUHLE_ENGINE_PLUGIN_H
+
+/*
+    C interface for engines loaded as shared libraries
+
+    The library exports a single function, muhle_engine_plugin, returning a static table.
+    Commands are plain function calls; info and best moves come back through the callbacks,
+    which may be invoked from any thread, but never after stop or destroy have returned.
+    Every go produces exactly one best move, also when the search is stopped.
+    Strings passed in either direction are only valid for the duration of the call.
+    Only stop may be called from a different thread than the rest, while another call is in progress.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MUHLE_ENGINE_PLUGIN_ABI_VERSION 2u
+#define MUHLE_ENGINE_PLUGIN_ENTRY "muhle_engine_plugin"
+
+#ifdef _WIN32
+    #define MUHLE_ENGINE_PLUGIN_EXPORT __declspec(dllexport)
+#else
+    #define MUHLE_ENGINE_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+enum {
+    MUHLE_INFO_DEPTH = 1u << 0,
+    MUHLE_INFO_TIME = 1u << 1,
+    MUHLE_INFO_NODES = 1u << 2,
+    MUHLE_INFO_MULTIPV = 1u << 3,
+    MUHLE_INFO_SCORE_EVAL = 1u << 4,
+    MUHLE_INFO_SCORE_WIN = 1u << 5,
+    MUHLE_INFO_PV = 1u << 6
+};
+
+typedef struct MuhleInfo {
+    unsigned int flags;  /* Which of the fields below are set */
+    unsigned int depth;
+    unsigned int time;
+    unsigned int nodes;
+    unsigned int multipv;
+    int score;
+    unsigned int pv_size;
+    const char* const* pv;
+} MuhleInfo;
+
+enum {
+    MUHLE_GO_WTIME = 1u << 0,
+    MUHLE_GO_BTIME = 1u << 1,
+    MUHLE_GO_DEPTH = 1u << 2,
+    MUHLE_GO_MOVETIME = 1u << 3,
+    MUHLE_GO_PONDER = 1u << 4,
+    MUHLE_GO_INFINITE = 1u << 5,
+    MUHLE_GO_WINC = 1u << 6,
+    MUHLE_GO_BINC = 1u << 7
+};
+
+typedef struct MuhleGo {
+    const char* position;  /* NULL means the start position */
+    unsigned int moves_size;
+    const char* const* moves;
+    unsigned int flags;
+    unsigned int wtime;
+    unsigned int btime;
+    unsigned int depth;
+    unsigned int movetime;
+    unsigned int winc;  /* Since version 2 */
+    unsigned int binc;
+} MuhleGo;
+
+typedef struct MuhleOption {
+    const char* name;
+    const char* type;  /* check, spin, combo, button or string */
+    const char* default_;  /* "true" or "false" for check */
+    int min;
+    int max;
+    unsigned int vars_size;
+    const char* const* vars;
+} MuhleOption;
+
+typedef void (*MuhleInfoCallback)(void* user_data, const MuhleInfo* info);
+typedef void (*MuhleBestMoveCallback)(void* user_data, const char* best_move, const char* ponder_move);  /* ponder_move may be NULL */
+
+/* Functions returning int return zero on success */
+typedef struct MuhleEnginePlugin {
+    unsigned int abi_version;
+    const char* name;
+    const char* author;
+    unsigned int options_size;
+    const MuhleOption* options;
+
+    void* (*create)(MuhleInfoCallback info_callback, MuhleBestMoveCallback best_move_callback, void* user_data);
+    void (*destroy)(void* instance);
+    int (*set_option)(void* instance, const char* name, const char* value);  /* value may be NULL */
+    int (*new_game)(void* instance);
+    int (*go)(void* instance, const MuhleGo* go);
+    void (*ponder_hit)(void* instance);
+    void (*stop)(void* instance);
+} MuhleEnginePlugin;
+
+typedef const MuhleEnginePlugin* (*MuhleEnginePluginEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,566 @@
+#include "headless.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <optional>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cassert>
+
+#include "board.hpp"
+#include "engine.hpp"
+#include "builtin_engine.hpp"
+#include "loader.hpp"
+#include "record.hpp"
+#include "referee.hpp"
+#include "trace.hpp"
+
+using namespace std::chrono_literals;
+
+namespace headless {
+    // Engine messages wake up the loop, so that it doesn't need to poll
+    class Waker {
+    public:
+        void wake() {
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                m_woken = true;
+            }
+
+            m_cv.notify_one();
+        }
+
+        void wait(std::optional<std::chrono::steady_clock::time_point> deadline) {
+            std::unique_lock<std::mutex> lock {m_mutex};
+
+            // There is always a deadline while a clock is running; the timeout is just in case
+            const auto until {deadline ? *deadline : std::chrono::steady_clock::now() + 1s};
+
+            m_cv.wait_until(lock, until, [this]() { return m_woken; });
+            m_woken = false;
+        }
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_woken {false};
+    };
+
+    // The same states as the GUI, minus the ones that need a human
+    class Session {
+    public:
+        explicit Session(const Config& config)
+            : m_config(config), m_referee(config.adjudication) {}
+
+        ~Session();
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+        Session(Session&&) = delete;
+        Session& operator=(Session&&) = delete;
+
+        void initialize();
+        board::GameOver play_game();
+
+        const std::vector<std::string>& get_moves() const { return m_moves; }
+        bool timed_out() const { return m_referee.timed_out(); }
+        bool adjudicated() const { return m_referee.adjudicated(); }
+        bool forfeited() const { return m_referee.forfeited(); }
+    private:
+        enum class State {
+            Start,
+            NextTurn,
+            ComputerThinking,
+            Stop,
+            Over
+        };
+
+        void update();
+        void flag();
+        void forfeit(board::Player player, const std::string& reason);
+        void replace_broken_engines();
+        void save_game();
+        engine::Engine& engine_to_move();
+        std::unique_ptr<engine::Engine> create_engine(const std::string& file_path);
+
+        const Config& m_config;
+        State m_state {State::Over};
+        Waker m_waker;
+        std::array<std::unique_ptr<engine::Engine>, 2> m_engines;  // White, black
+        std::array<bool, 2> m_broken {};  // Replaced before the next game
+        board::Board m_board;
+        std::vector<std::string> m_moves;
+        clock_::Clock m_clock;
+        referee::Referee m_referee;
+        record::RecordWriter m_record_writer;  // Open for the whole match, since closing writes the whole index
+    };
+
+    Session::~Session() {
+        for (const auto& engine : m_engines) {
+            if (!engine) {
+                continue;
+            }
+
+            try {
+                engine->uninitialize();
+            } catch (const engine::EngineError& e) {
+                std::cerr << "Engine error: " << e.what() << '\n';
+            }
+        }
+
+        try {
+            m_record_writer.close();
+        } catch (const record::RecordError& e) {
+            std::cerr << "Could not save games: " << e.what() << '\n';
+        }
+    }
+
+    void Session::initialize() {
+        m_engines[0] = create_engine(m_config.white_engine);
+        m_engines[1] = create_engine(m_config.black_engine);
+
+        m_board = board::Board([this](const board::Move& move) {
+            m_moves.push_back(board::move_to_string(move));
+        });
+
+        m_board.twelve_mens_morris(m_config.twelve_mens_morris);
+    }
+
+    board::GameOver Session::play_game() {
+        try {
+            m_board.reset(m_config.position ? board::position_from_string(*m_config.position) : board::Position());
+        } catch (const board::BoardError& e) {
+            throw HeadlessError("Invalid position: " + std::string(e.what()));
+        }
+
+        replace_broken_engines();
+
+        m_moves.clear();
+        m_referee.reset();
+
+        m_state = State::Start;
+
+        for (std::size_t i {0}; i < m_engines.size(); i++) {
+            try {
+                m_engines[i]->new_game();
+                m_engines[i]->synchronize();
+            } catch (const engine::EngineError& e) {
+                forfeit(i == 0 ? board::Player::White : board::Player::Black, "Engine error: " + std::string(e.what()));
+                break;
+            }
+        }
+
+        while (m_state != State::Over) {
+            // Only the engine to move is talked to, so it's the one at fault
+            try {
+                update();
+            } catch (const engine::EngineError& e) {
+                forfeit(m_board.get_player(), "Engine error: " + std::string(e.what()));
+            }
+        }
+
+        return m_board.get_game_over();
+    }
+
+    void Session::update() {
+        switch (m_state) {
+            case State::Start:
+                m_clock.reset(m_config.time_control);
+
+                if (m_board.get_player() == board::Player::Black) {
+                    m_clock.switch_turn();
+                }
+
+                m_clock.start();
+                m_state = State::NextTurn;
+
+                break;
+            case State::NextTurn:
+                if (m_board.get_game_over() != board::GameOver::None) {
+                    m_state = State::Stop;
+                    break;
+                }
+
+                trace::instant("start_thinking");
+
+                engine_to_move().start_thinking(
+                    board::position_to_string(m_board.get_setup_position()),
+                    m_moves,
+                    m_clock.get_white_time(),
+                    m_clock.get_black_time(),
+                    m_clock.get_engine_increment(),
+                    m_clock.get_engine_increment(),
+                    std::nullopt,
+                    std::nullopt
+                );
+
+                m_state = State::ComputerThinking;
+
+                break;
+            case State::ComputerThinking: {
+                engine::Engine& engine {engine_to_move()};
+                const auto best_move {engine.done_thinking()};
+                const auto deadline {m_clock.get_deadline()};
+
+                if (!best_move) {
+                    if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+                        engine.stop_thinking();
+                        flag();
+                        break;
+                    }
+
+                    if (!engine.alive()) {
+                        throw engine::EngineError("Engine died");
+                    }
+
+                    {
+                        trace::Span span {"wait"};
+                        m_waker.wait(deadline);
+                    }
+
+                    break;
+                }
+
+                // Don't charge the engine for the time this loop needed to notice its move
+                const auto time {engine.get_best_move_time()};
+
+                if (*best_move != "none" && deadline && time >= *deadline) {
+                    flag();
+                    break;
+                }
+
+                const auto player {m_board.get_player()};
+
+                if (m_referee.play_engine_move(m_board, *best_move)) {
+                    if (m_referee.forfeited()) {
+                        m_broken[player == board::Player::White ? 0 : 1] = true;
+                    }
+
+                    m_state = State::Stop;
+                    break;
+                }
+
+                m_clock.switch_turn(time);
+                m_state = State::NextTurn;
+
+                break;
+            }
+            case State::Stop:
+                m_clock.stop();
+                save_game();
+                m_state = State::Over;
+
+                break;
+            case State::Over:
+                break;
+        }
+    }
+
+    void Session::flag() {
+        m_referee.flag(m_board);
+        m_state = State::Stop;
+    }
+
+    void Session::forfeit(board::Player player, const std::string& reason) {
+        m_referee.forfeit(m_board, player, reason);
+        m_broken[player == board::Player::White ? 0 : 1] = true;
+        m_state = State::Stop;
+    }
+
+    void Session::replace_broken_engines() {
+        for (std::size_t i {0}; i < m_engines.size(); i++) {
+            if (!m_broken[i]) {
+                continue;
+            }
+
+            try {
+                m_engines[i]->uninitialize();
+            } catch (const engine::EngineError&) {}
+
+            // If this fails too, the match can't go on
+            m_engines[i] = create_engine(i == 0 ? m_config.white_engine : m_config.black_engine);
+            m_broken[i] = false;
+        }
+    }
+
+    void Session::save_game() {
+        if (!m_config.record_file_path || m_moves.empty()) {
+            return;
+        }
+
+        const record::Game game {m_referee.make_record(m_board, m_moves, m_config.twelve_mens_morris)};
+
+        try {
+            if (!m_record_writer.is_open()) {
+                m_record_writer.open(*m_config.record_file_path);
+            }
+
+            m_record_writer.append(game.header, game.moves);
+        } catch (const record::RecordError& e) {
+            std::cerr << "Could not save game: " << e.what() << '\n';
+        }
+    }
+
+    engine::Engine& Session::engine_to_move() {
+        return *m_engines[m_board.get_player() == board::Player::White ? 0 : 1];
+    }
+
+    std::unique_ptr<engine::Engine> Session::create_engine(const std::string& file_path) {
+        std::unique_ptr<engine::Engine> engine;
+
+        if (file_path.empty()) {
+            engine = std::make_unique<engine::BuiltinEngine>();
+        } else {
+            engine = loader::create_engine(file_path);
+        }
+
+        engine->set_wake_callback([this]() {
+            m_waker.wake();
+        });
+
+        // Only the engine to move is thinking, so the messages can't mix
+        engine->set_info_callback([this](const engine::Engine::Info& info) {
+            m_referee.update(info);
+        });
+
+        loader::initialize_engine(*engine, file_path);
+
+        // The variant is always set, like in the GUI, since engines may default to either
+        const auto iter {std::find_if(engine->get_options().cbegin(), engine->get_options().cend(), [](const auto& option) {
+            return option.name == "TwelveMensMorris";
+        })};
+
+        if (iter != engine->get_options().cend()) {
+            engine->set_option("TwelveMensMorris", m_config.twelve_mens_morris ? "true" : "false");
+        } else if (m_config.twelve_mens_morris) {
+            throw HeadlessError("Engine doesn't support twelve men's morris");
+        }
+
+        engine->synchronize();
+
+        return engine;
+    }
+
+    // Scores are compared by magnitude, so they can't be negative
+    static int parse_score(const char* name, const char* value) {
+        std::size_t end {0};
+        int result {0};
+
+        try {
+            result = std::stoi(value, &end);
+        } catch (const std::exception&) {
+            end = 0;
+        }
+
+        if (end == 0 || value[end] != '\0' || result < 0) {
+            throw HeadlessError("Invalid value `" + std::string(value) + "` for " + name);
+        }
+
+        return result;
+    }
+
+    static unsigned int parse_unsigned(const char* name, const char* value) {
+        std::size_t end {0};
+        unsigned long result {0};
+
+        try {
+            result = std::stoul(value, &end);
+        } catch (const std::exception&) {
+            end = 0;
+        }
+
+        if (end == 0 || value[end] != '\0' || result > std::numeric_limits<unsigned int>::max()) {
+            throw HeadlessError("Invalid value `" + std::string(value) + "` for " + name);
+        }
+
+        return static_cast<unsigned int>(result);
+    }
+
+    Config parse_arguments(int argc, char** argv) {
+        Config config;
+
+        for (int i {1}; i < argc; i++) {
+            const char* argument {argv[i]};
+
+            if (std::strcmp(argument, "--headless") == 0) {
+                continue;
+            }
+
+            if (std::strcmp(argument, "--twelve") == 0) {
+                config.twelve_mens_morris = true;
+                continue;
+            }
+
+            // Every other flag takes a value
+            if (i + 1 == argc) {
+                throw HeadlessError("Missing value for " + std::string(argument));
+            }
+
+            const char* value {argv[++i]};
+
+            if (std::strcmp(argument, "--engine") == 0) {
+                config.white_engine = value;
+                config.black_engine = value;
+            } else if (std::strcmp(argument, "--white") == 0) {
+                config.white_engine = value;
+            } else if (std::strcmp(argument, "--black") == 0) {
+                config.black_engine = value;
+            } else if (std::strcmp(argument, "--position") == 0) {
+                config.position = value;
+            } else if (std::strcmp(argument, "--time") == 0) {
+                config.time_control.time = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--increment") == 0) {
+                config.time_control.increment = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--delay") == 0) {
+                config.time_control.delay = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--moves") == 0) {
+                config.time_control.moves = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--games") == 0) {
+                config.games = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--resign-moves") == 0) {
+                config.adjudication.resign_moves = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--resign-score") == 0) {
+                config.adjudication.resign_score = parse_score(argument, value);
+            } else if (std::strcmp(argument, "--draw-moves") == 0) {
+                config.adjudication.draw_moves = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--draw-score") == 0) {
+                config.adjudication.draw_score = parse_score(argument, value);
+            } else if (std::strcmp(argument, "--draw-ply") == 0) {
+                config.adjudication.draw_ply = parse_unsigned(argument, value);
+            } else if (std::strcmp(argument, "--record") == 0) {
+                config.record_file_path = value;
+            } else if (std::strcmp(argument, "--trace") == 0) {
+                config.trace_file_path = value;
+            } else {
+                throw HeadlessError("Unknown argument " + std::string(argument));
+            }
+        }
+
+        return config;
+    }
+
+    const char* usage() {
+        return
+            "Usage: muhle_player --headless [options]\n"
+            "  --engine PATH      engine for both sides; the built-in engine by default\n"
+            "  --white PATH       engine for white\n"
+            "  --black PATH       engine for black\n"
+            "  --position STRING  setup position\n"
+            "  --time MS          time per player\n"
+            "  --increment MS     time added after every move\n"
+            "  --delay MS         Bronstein delay; the time used, up to this much, is given back\n"
+            "  --moves N          moves per time control session\n"
+            "  --games N          number of games to play\n"
+            "  --twelve           play twelve men's morris\n"
+            "  --resign-moves N   adjudicate a win when both engines see it for N moves each\n"
+            "  --resign-score N   evaluation that counts as a win; 1000 by default\n"
+            "  --draw-moves N     adjudicate a draw when both engines see it for N moves each\n"
+            "  --draw-score N     evaluation that counts as a draw; 10 by default\n"
+            "  --draw-ply N       no draw adjudication before this ply; 60 by default\n"
+            "  --record PATH      append the games to a record file\n"
+            "  --trace PATH       write a Chrome trace of the whole session\n";
+    }
+
+    static const char* result_to_string(board::GameOver game_over) {
+        switch (game_over) {
+            case board::GameOver::None:
+                return "*";
+            case board::GameOver::WinnerWhite:
+                return "1-0";
+            case board::GameOver::WinnerBlack:
+                return "0-1";
+            case board::GameOver::Draw:
+                return "1/2-1/2";
+        }
+
+        return {};
+    }
+
+    static void write_trace(const Config& config) {
+        if (!config.trace_file_path) {
+            return;
+        }
+
+        trace::stop();
+
+        try {
+            trace::write(*config.trace_file_path);
+        } catch (const trace::TraceError& e) {
+            std::cerr << e.what() << '\n';
+        }
+    }
+
+    int run(const Config& config) {
+        unsigned int white_wins {0};
+        unsigned int black_wins {0};
+        unsigned int draws {0};
+
+        int exit_code {0};
+
+        if (config.trace_file_path) {
+            trace::set_thread_name("main");
+            trace::start();
+        }
+
+        // Games lost by a broken engine are forfeited; only a failure to replace it ends the match
+        try {
+            Session session {config};
+            session.initialize();
+
+            for (unsigned int i {0}; i < config.games; i++) {
+                const auto result {session.play_game()};
+
+                switch (result) {
+                    case board::GameOver::None:
+                        assert(false);
+                        break;
+                    case board::GameOver::WinnerWhite:
+                        white_wins++;
+                        break;
+                    case board::GameOver::WinnerBlack:
+                        black_wins++;
+                        break;
+                    case board::GameOver::Draw:
+                        draws++;
+                        break;
+                }
+
+                std::cout << "Game " << i + 1 << ": " << result_to_string(result);
+
+                if (session.timed_out()) {
+                    std::cout << " (time)";
+                } else if (session.adjudicated()) {
+                    std::cout << " (adjudication)";
+                } else if (session.forfeited()) {
+                    std::cout << " (forfeit)";
+                }
+
+                std::cout << ", " << session.get_moves().size() << " plies:";
+
+                for (const auto& move : session.get_moves()) {
+                    std::cout << ' ' << move;
+                }
+
+                std::cout << std::endl;
+            }
+        } catch (const engine::EngineError& e) {
+            std::cerr << "Engine error: " << e.what() << '\n';
+            exit_code = 1;
+        } catch (const HeadlessError& e) {
+            std::cerr << e.what() << '\n';
+            exit_code = 1;
+        }
+
+        write_trace(config);
+
+        std::cout << "White " << white_wins << ", black " << black_wins << ", draws " << draws << '\n';
+
+        return exit_code;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <stdexcept>
+
+#include "clock.hpp"
+#include "adjudication.hpp"
+
+namespace headless {
+    // Everything comes from the command line
+    struct Config {
+        std::string white_engine;  // An empty path means the built-in engine
+        std::string black_engine;
+        std::optional<std::string> position;
+        clock_::TimeControl time_control;
+        unsigned int games {1};
+        bool twelve_mens_morris {false};
+        adjudication::Settings adjudication;
+        std::optional<std::string> record_file_path;
+        std::optional<std::string> trace_file_path;
+    };
+
+    // Arguments other than the headless flag itself
+    Config parse_arguments(int argc, char** argv);
+    const char* usage();
+
+    // Play engine against engine without a window, printing the results; returns the exit code
+    int run(const Config& config);
+
+    struct HeadlessError : std::runtime_error {
+        explicit HeadlessError(const char* message)
+            : std::runtime_error(message) {}
+        explicit HeadlessError(const std::string& message)
+            : std::runtime_error(message) {}
+    };
+}
@@ -0,0 +1,153 @@
+#include "loader.hpp"
+
+#include <utility>
+#include <optional>
+#include <cassert>
+
+#include "capability_cache.hpp"
+#include "plugin_engine.hpp"
+
+namespace loader {
+    static constexpr const char* CACHE_FILE_PATH {"muhle_player.cache"};
+
+    EngineLoader::~EngineLoader() {
+        cancel();
+        finish();
+    }
+
+    void EngineLoader::load(const std::string& file_path, const Options& options) {
+        assert(m_stage == Stage::Idle);
+
+        m_engine = create_engine(file_path);
+        m_engine->set_log_output(true);
+        m_engine->set_wake_callback(std::function<void()>(m_wake_callback));
+
+        m_error.clear();
+        m_cancelled = false;
+        m_stage = Stage::Initializing;
+
+        m_thread = std::thread(&EngineLoader::task, this, file_path, options);
+    }
+
+    void EngineLoader::cancel() {
+        if (!loading()) {
+            return;
+        }
+
+        m_cancelled = true;
+        m_engine->interrupt();
+    }
+
+    std::unique_ptr<engine::Engine> EngineLoader::finish() {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+
+        const Stage stage {m_stage.exchange(Stage::Idle)};
+
+        if (stage != Stage::Done || m_cancelled) {
+            m_engine.reset();
+        }
+
+        return std::exchange(m_engine, nullptr);
+    }
+
+    bool EngineLoader::loading() const {
+        const Stage stage {m_stage.load()};
+
+        return stage == Stage::Initializing || stage == Stage::Synchronizing;
+    }
+
+    bool EngineLoader::finished() const {
+        const Stage stage {m_stage.load()};
+
+        return stage == Stage::Done || stage == Stage::Failed || stage == Stage::Cancelled;
+    }
+
+    const char* EngineLoader::stage_to_string(Stage stage) {
+        switch (stage) {
+            case Stage::Idle:
+                return "idle";
+            case Stage::Initializing:
+                return "initializing";
+            case Stage::Synchronizing:
+                return "synchronizing";
+            case Stage::Done:
+                return "done";
+            case Stage::Failed:
+                return "failed";
+            case Stage::Cancelled:
+                return "cancelled";
+        }
+
+        return {};
+    }
+
+    void EngineLoader::task(const std::string& file_path, const Options& options) {
+        try {
+            initialize_engine(*m_engine, file_path);
+            m_engine->set_debug(true);
+
+            for (const auto& [name, value] : options) {
+                m_engine->set_option(name, value);
+            }
+
+            m_engine->new_game();
+
+            set_stage(Stage::Synchronizing);
+
+            m_engine->synchronize();
+        } catch (const engine::EngineError& e) {
+            m_error = e.what();
+            set_stage(m_cancelled ? Stage::Cancelled : Stage::Failed);
+            return;
+        }
+
+        set_stage(Stage::Done);
+    }
+
+    void EngineLoader::set_stage(Stage stage) {
+        m_stage = stage;
+
+        if (m_wake_callback) {
+            m_wake_callback();
+        }
+    }
+
+    std::unique_ptr<engine::Engine> create_engine(const std::string& file_path) {
+        if (engine::PluginEngine::is_plugin(file_path)) {
+            return std::make_unique<engine::PluginEngine>();
+        } else {
+            return std::make_unique<engine::SubprocessEngine>();
+        }
+    }
+
+    void initialize_engine(engine::Engine& engine, const std::string& file_path) {
+        capability_cache::CapabilityCache cache;
+        std::optional<capability_cache::Identity> identity;
+        std::optional<engine::Engine::Capabilities> capabilities;
+
+        // Plugins report their capabilities without any handshake and the built-in engine has no file
+        if (!file_path.empty() && !engine::PluginEngine::is_plugin(file_path)) {
+            try {
+                identity = capability_cache::CapabilityCache::identify(file_path);
+                cache.load(CACHE_FILE_PATH);
+                capabilities = cache.find(*identity);
+            } catch (const capability_cache::CapabilityCacheError&) {
+                // Go on without the cache
+            }
+        }
+
+        engine.initialize(file_path, capabilities);
+
+        if (identity && !capabilities) {
+            cache.insert(*identity, engine.get_capabilities());
+
+            try {
+                cache.save(CACHE_FILE_PATH);
+            } catch (const capability_cache::CapabilityCacheError&) {
+                // Not important
+            }
+        }
+    }
+}
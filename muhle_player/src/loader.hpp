@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "engine.hpp"
+
+namespace loader {
+    enum class Stage {
+        Idle,
+        Initializing,
+        Synchronizing,
+        Done,
+        Failed,
+        Cancelled
+    };
+
+    // Starts an engine and goes through the handshake on a separate thread
+    class EngineLoader {
+    public:
+        EngineLoader() = default;
+        ~EngineLoader();
+
+        EngineLoader(const EngineLoader&) = delete;
+        EngineLoader& operator=(const EngineLoader&) = delete;
+        EngineLoader(EngineLoader&&) = delete;
+        EngineLoader& operator=(EngineLoader&&) = delete;
+
+        using Options = std::vector<std::pair<std::string, std::optional<std::string>>>;
+
+        // The options are set right after the handshake, before the new game
+        void load(const std::string& file_path, const Options& options = {});
+        void cancel();
+
+        // Called from the loading thread on every change of stage; also given to the engine
+        void set_wake_callback(std::function<void()>&& wake_callback) { m_wake_callback = std::move(wake_callback); }
+
+        // Join the thread and hand over the engine, if it was loaded successfully
+        std::unique_ptr<engine::Engine> finish();
+
+        Stage get_stage() const { return m_stage.load(); }
+        bool loading() const;
+        bool finished() const;
+        const std::string& get_error() const { return m_error; }
+
+        static const char* stage_to_string(Stage stage);
+    private:
+        void task(const std::string& file_path, const Options& options);
+        void set_stage(Stage stage);
+
+        std::unique_ptr<engine::Engine> m_engine;
+        std::thread m_thread;
+        std::atomic<Stage> m_stage {Stage::Idle};
+        std::atomic<bool> m_cancelled {false};
+        std::string m_error;
+        std::function<void()> m_wake_callback;
+    };
+
+    // Shared libraries are loaded as plugins, anything else is started as a process
+    std::unique_ptr<engine::Engine> create_engine(const std::string& file_path);
+
+    // Handshake that takes the capabilities from the cache on disk when the engine binary is known
+    void initialize_engine(engine::Engine& engine, const std::string& file_path);
+}
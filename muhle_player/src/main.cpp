@@ -1,10 +1,28 @@
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <csignal>
 
 #include <gui_base/gui_base.hpp>
 
 #include "muhle_player.hpp"
+#include "headless.hpp"
+
+int main(int argc, char** argv) {
+#ifndef _WIN32
+    // Writing to a dead engine must result in an error, not in the termination of the program
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (std::any_of(argv + 1, argv + argc, [](const char* argument) { return std::strcmp(argument, "--headless") == 0; })) {
+        try {
+            return headless::run(headless::parse_arguments(argc, argv));
+        } catch (const headless::HeadlessError& e) {
+            std::cerr << e.what() << '\n' << headless::usage();
+            return 1;
+        }
+    }
 
-int main() {
     gui_base::WindowProperties properties;
     properties.width = 1024;
     properties.height = 576;
@@ -3,24 +3,64 @@
 #include <iostream>
 #include <filesystem>
 #include <stdexcept>
-#include <numeric>
 #include <algorithm>
+#include <cmath>
+#include <utility>
 #include <cassert>
 
 #include <gui_base/gui_base.hpp>
 #include <ImGuiFileDialog.h>
 
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
 void MuhlePlayer::start() {
+    trace::set_thread_name("main");
+
     ImGuiIO& io {ImGui::GetIO()};
     io.ConfigWindowsMoveFromTitleBarOnly = true;
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
+    // Engine messages need to wake up the main loop
+    m_loader.set_wake_callback([]() {
+        glfwPostEmptyEvent();
+    });
+
+    m_annotator.set_wake_callback([]() {
+        glfwPostEmptyEvent();
+    });
+
     m_board = board::Board([this](const board::Move& move) {
+        // A move played from an earlier ply replaces the moves after it
+        truncate_moves(m_board.get_ply() - 1);
         m_moves.push_back(board::move_to_string(move));
 
-        m_clock.switch_turn();
+        if (m_replaying) {
+            return;
+        }
+
+        if (m_state == State::Analysis) {
+            restart_analysis();
+            return;
+        }
+
+        // Don't charge the engine for the time the GUI needed to notice its move
+        // Late moves never get here; they are checked before being played
+        const auto time {
+            m_state == State::ComputerThinking ? m_engine->get_best_move_time() : m_input_time
+        };
+
+        if (m_state == State::ComputerThinking) {
+            record_overhead();
+        }
+
+        m_clock.switch_turn(time);
+        m_turn_start = std::chrono::steady_clock::now();
+
+        schedule_timeout();
 
         if (m_board.get_game_over() != board::GameOver::None) {
+            stop_pondering();
             assert_engine_game_over();
             m_state = State::Stop;
             return;
@@ -31,34 +71,62 @@ void MuhlePlayer::start() {
 }
 
 void MuhlePlayer::update() {
+    wait_for_events();
+
+    // Waiting for events is not part of the frame
+    MUHLE_PROFILE_BEGIN_FRAME();
+    trace::Span span {"frame"};
+
     main_menu_bar();
     board();
     controls();
     game();
     options();
+    position_search();
     load_engine_dialog();
+#ifdef MUHLE_PROFILER
+    frame_profile();
+#endif
 
-    m_clock.update();
+    update_loader();
+    update_annotation();
 
-    if (m_clock.get_white_time() == 0) {
-        m_board.timeout(board::Player::White);
-    }
-
-    if (m_clock.get_black_time() == 0) {
-        m_board.timeout(board::Player::Black);
-    }
+    MUHLE_PROFILE_SCOPE("state machine");
 
     switch (m_state) {
         case State::Ready:
             break;
         case State::Start:
+            // Games continue from the ply shown
+            m_board.discard_future();
+            truncate_moves(m_board.get_ply());
+
+            m_game_recoveries = 0;
+
+            // Only engines report scores, so games with a human are never adjudicated
+            if (m_white == PlayerComputer && m_black == PlayerComputer) {
+                m_referee.set_adjudication(get_adjudication());
+            } else {
+                m_referee.set_adjudication(adjudication::Settings());
+            }
+
+            m_referee.reset();
+            m_clock.reset(get_time_control());
+
+            if (m_board.get_player() == board::Player::Black) {
+                m_clock.switch_turn();
+            }
+
             m_clock.start();
+            m_turn_start = std::chrono::steady_clock::now();
+            schedule_timeout();
             m_state = State::NextTurn;
 
             break;
         case State::NextTurn: {
             switch (get_board_player_type()) {
                 case PlayerHuman:
+                    start_pondering();
                     m_state = State::HumanThinking;
                     break;
                 case PlayerComputer:
@@ -69,27 +137,92 @@ void MuhlePlayer::update() {
             break;
         }
         case State::HumanThinking:
+            if (m_pondering) {
+                assert(m_engine);
+
+                try {
+                    // A best move here (like none after a terminal ponder move) ends the ponder search
+                    if (m_engine->done_thinking()) {
+                        m_ponder_ended = true;
+                    }
+                } catch (const engine::EngineError& e) {
+                    engine_error(e);
+                }
+            }
+
             break;
         case State::ComputerStartThinking:
-            assert(m_engine);
+            if (!m_engine) {
+                // The engine has died while the human was thinking
+                if (m_loader.loading()) {
+                    m_state = State::ComputerRecovering;
+                } else {
+                    forfeit_engine("The engine is gone");
+                }
+
+                break;
+            }
+
+            if (m_pondering) {
+                m_pondering = false;
+
+                if (m_moves.back() == m_ponder_move && !m_ponder_ended) {
+                    m_ponder_hits++;
+
+                    try {
+                        m_engine->ponder_hit();
+                    } catch (const engine::EngineError& e) {
+                        engine_error(e);
+                        break;
+                    }
+
+                    m_state = State::ComputerThinking;
+
+                    break;
+                }
+
+                m_ponder_misses++;
+
+                try {
+                    m_engine->stop_thinking();  // The stale best move is discarded by the engine
+                } catch (const engine::EngineError& e) {
+                    engine_error(e);
+                    break;
+                }
+            }
+
+            clear_search_series();
 
             try {
                 m_engine->start_thinking(
                     board::position_to_string(m_board.get_setup_position()),
                     m_moves,
-                    m_clock.get_white_time(),
-                    m_clock.get_black_time(),
+                    subtract_move_overhead(m_clock.get_white_time()),
+                    subtract_move_overhead(m_clock.get_black_time()),
+                    m_clock.get_engine_increment(),
+                    m_clock.get_engine_increment(),
                     std::nullopt,
                     std::nullopt
                 );
             } catch (const engine::EngineError& e) {
                 engine_error(e);
-                m_state = State::Stop;
                 break;
             }
 
             m_state = State::ComputerThinking;
 
+            break;
+        case State::ComputerRecovering:
+            if (m_engine) {
+                m_state = State::ComputerStartThinking;  // The position is replayed from the moves
+                break;
+            }
+
+            if (!m_loader.loading() || std::chrono::steady_clock::now() > m_recovery_deadline) {
+                m_loader.cancel();
+                forfeit_engine("Could not recover the engine in time");
+            }
+
             break;
         case State::ComputerThinking: {
             assert(m_engine);
@@ -100,72 +233,182 @@ void MuhlePlayer::update() {
                 best_move = m_engine->done_thinking();
             } catch (const engine::EngineError& e) {
                 engine_error(e);
-                m_state = State::Stop;
                 break;
             }
 
             if (best_move) {
-                if (*best_move == "none") {
-                    if (m_board.get_game_over() == board::GameOver::None) {
-                        throw std::runtime_error("The engine calls game over, but the GUI doesn't agree");
-                    }
-                } else {
-                    m_board.play_move(board::move_from_string(*best_move));
+                format_info();  // Keep the final line before it's moved into the history
+                record_score();
+                m_search_history.commit();
+
+                const auto deadline {m_clock.get_deadline()};
+
+                if (*best_move != "none" && deadline && m_engine->get_best_move_time() >= *deadline) {
+                    // The move came too late; the timeout just hasn't been processed yet
+                    flag();
+                } else if (m_referee.play_engine_move(m_board, *best_move)) {
+                    m_state = State::Stop;  // Also when the rules ended the game, which the move callback already noticed
                 }
             }
 
             break;
         }
+        case State::Analysis:
+            if (!m_engine) {
+                if (!m_loader.loading()) {
+                    m_state = State::Ready;
+                }
+
+                break;
+            }
+
+            try {
+                m_engine->done_thinking();  // An infinite search never ends by itself
+            } catch (const engine::EngineError& e) {
+                engine_error(e);
+            }
+
+            break;
         case State::Stop:
             m_clock.stop();
+            m_timer.cancel();
+            save_game();
             m_state = State::Over;
 
             break;
         case State::Over:
             break;
     }
+
+    // After the state machine, so that a move which arrived just in time is played first
+    if (m_timeout.exchange(false)) {
+        check_timeout();
+    }
+
+    check_engine_alive();
+
+    MUHLE_PROFILE_END_FRAME();
 }
 
 void MuhlePlayer::stop() {
+    m_annotator.cancel();
+    m_annotator.finish();
+
+    if (m_index_thread.joinable()) {
+        m_index_thread.join();
+    }
+
+    save_pending_games();
+    close_games_file();
+
+    m_loader.cancel();
+    m_loader.finish();
+
     unload_engine();
 }
 
 void MuhlePlayer::load_engine(const std::string& file_path) {
     assert(!m_engine);
 
-    m_engine = std::make_unique<engine::Engine>();
-    m_engine->set_log_output(true);
+    m_loader.cancel();
+    m_loader.finish();
+
+    m_loader.load(file_path);
+
+    m_engine_path = file_path;
+    m_engine_options.clear();
+    m_recoveries = 0;
+}
+
+void MuhlePlayer::update_loader() {
+    MUHLE_PROFILE_SCOPE("update_loader");
+
+    if (!m_loader.finished()) {
+        return;
+    }
+
+    const auto stage {m_loader.get_stage()};
+    auto engine {m_loader.finish()};
+
+    if (!engine) {
+        std::cerr << "Engine error: " << m_loader.get_error() << " (" << loader::EngineLoader::stage_to_string(stage) << ")\n";
+        return;
+    }
+
+    use_engine(std::move(engine));
+}
+
+void MuhlePlayer::load_builtin_engine() {
+    assert(!m_engine);
+
+    m_loader.cancel();
+    m_loader.finish();
+
+    auto engine {std::make_unique<engine::BuiltinEngine>()};
+    engine->set_wake_callback([]() {
+        glfwPostEmptyEvent();
+    });
+
+    try {
+        engine->initialize({}, std::nullopt);
+        engine->new_game();
+        engine->synchronize();
+    } catch (const engine::EngineError& e) {
+        std::cerr << "Engine error: " << e.what() << '\n';
+        return;
+    }
+
+    // There is no process to restart
+    m_engine_path.clear();
+    m_engine_options.clear();
+    m_recoveries = 0;
+
+    use_engine(std::move(engine));
+}
+
+void MuhlePlayer::use_engine(std::unique_ptr<engine::Engine>&& engine) {
+    m_engine = std::move(engine);
+
+    if (m_state != State::ComputerRecovering) {
+        m_ponder_hits = 0;
+        m_ponder_misses = 0;
+    }
+
     m_engine->set_info_callback([this](const engine::Engine::Info& info) {
-        if (info.score) {
-            switch (info.score->index()) {
-                case 0:
-                    m_score = "eval " + std::to_string(std::get<0>(*info.score).value);
-                    break;
-                case 1:
-                    m_score = "win " + std::to_string(std::get<1>(*info.score).value);
-                    break;
-            }
+        MUHLE_PROFILE_SCOPE("info callback");
+
+        // Only record the message; the text is formatted at most once per frame
+        if (m_state == State::Analysis && info.multipv) {
+            update_analysis_line(*info.multipv, info);
         }
 
-        if (info.pv) {
-            if (info.pv->empty()) {
-                m_pv.clear();
-            } else {
-                m_pv = std::accumulate(++info.pv->cbegin(), info.pv->cend(), *info.pv->cbegin(), [](std::string r, const std::string& move) {
-                    return std::move(r) + " " + move;
-                });
+        // Only the searches for the moves that are played count
+        if (m_state == State::ComputerThinking) {
+            m_referee.update(info);
+        }
+
+        if (!info.multipv || *info.multipv == 1) {
+            m_search_history.update(info);
+
+            const auto time {static_cast<float>(info.time.value_or(0))};
+
+            if (info.depth) {
+                m_depth_series.push(time, static_cast<float>(*info.depth));
+            }
+
+            if (info.nodes) {
+                m_nodes_series.push(time, static_cast<float>(*info.nodes));
             }
         }
+
+        m_info_dirty = true;
     });
 
-    try {
-        m_engine->initialize(file_path);
-        m_engine->set_debug(true);
-        m_engine->new_game();
-        m_engine->synchronize();
-    } catch (const engine::EngineError& e) {
-        engine_error(e);
+    if (m_state == State::Analysis) {
+        restart_analysis();
     }
+
+    schedule_timeout();
 }
 
 void MuhlePlayer::unload_engine() {
@@ -173,6 +416,8 @@ void MuhlePlayer::unload_engine() {
         return;
     }
 
+    m_timer.cancel();  // It may refer to the engine
+
     try {
         m_engine->uninitialize();
     } catch (const engine::EngineError& e) {
@@ -180,6 +425,8 @@ void MuhlePlayer::unload_engine() {
     }
 
     m_engine.reset();
+
+    schedule_timeout();
 }
 
 void MuhlePlayer::main_menu_bar() {
@@ -188,6 +435,11 @@ void MuhlePlayer::main_menu_bar() {
             if (ImGui::MenuItem("Load Engine")) {
                 load_engine();
             }
+            if (ImGui::MenuItem("Load Built-in Engine")) {
+                unload_engine();
+                load_builtin_engine();
+                reset_position(std::nullopt);
+            }
             if (ImGui::MenuItem("Reset Position")) {
                 reset_position(std::nullopt);
             }
@@ -206,6 +458,27 @@ void MuhlePlayer::main_menu_bar() {
             if (ImGui::MenuItem("Twelve Men's Morris", nullptr, &m_twelve_mens_morris, static_cast<bool>(m_engine))) {
                 set_twelve_mens_morris();
             }
+            if (ImGui::MenuItem("Ponder", nullptr, &m_ponder, static_cast<bool>(m_engine))) {
+                set_ponder();
+            }
+
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Trace")) {
+            if (ImGui::MenuItem("Record", nullptr, trace::recording())) {
+                if (trace::recording()) {
+                    trace::stop();
+                } else {
+                    trace::start();
+                }
+            }
+            if (ImGui::MenuItem("Save")) {
+                try {
+                    trace::write(TRACE_FILE_PATH);
+                } catch (const trace::TraceError& e) {
+                    std::cerr << e.what() << '\n';
+                }
+            }
 
             ImGui::EndMenu();
         }
@@ -236,6 +509,8 @@ void MuhlePlayer::load_engine() {
 }
 
 void MuhlePlayer::load_engine_dialog() {
+    MUHLE_PROFILE_SCOPE("load_engine_dialog");
+
     if (ImGuiFileDialog::Instance()->Display("FileDialog", 32, ImVec2(768, 432))) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             const std::string file_path {ImGuiFileDialog::Instance()->GetFilePathName()};
@@ -268,11 +543,25 @@ void MuhlePlayer::reset_position(const std::optional<std::string>& position) {
         std::cerr << "Invalid input: " << e.what() << '\n';
     }
 
+    m_timer.cancel();
+    m_timeout = false;
     m_state = State::Ready;
+    m_pondering = false;
     m_moves.clear();
+    stop_annotation();
+    m_score_series.clear();
+    m_scores.clear();
+    clear_search_series();
+    m_search_history.clear();
+    m_analysis_lines.clear();
+    m_analysis_text.clear();
+    m_info_dirty = false;
     m_score.clear();
     m_pv.clear();
-    m_clock.reset();
+    m_overhead_moves = 0;
+    m_overhead_total = {};
+    m_overhead_max = {};
+    m_clock.reset(get_time_control());
 
     if (m_board.get_setup_position().player == board::Player::Black) {
         m_clock.switch_turn();
@@ -292,13 +581,34 @@ void MuhlePlayer::about() {
 }
 
 void MuhlePlayer::board() {
-    m_board.update(m_state == State::HumanThinking);
+    MUHLE_PROFILE_SCOPE("board");
+
+    // A human move made this frame counts from now, so it must not be taken after the deadline
+    m_input_time = std::chrono::steady_clock::now();
+
+    if (m_state == State::HumanThinking) {
+        check_timeout();
+    }
+
+    m_board.update(m_state == State::HumanThinking || m_state == State::Analysis);
     m_board.debug();
 }
 
 void MuhlePlayer::controls() {
+    MUHLE_PROFILE_SCOPE("controls");
+
     if (ImGui::Begin("Controls")) {
         ImGui::Text("Engine: %s", m_engine ? m_engine->get_name().c_str() : "");
+
+        if (m_loader.loading()) {
+            ImGui::Text("Loading engine: %s...", loader::EngineLoader::stage_to_string(m_loader.get_stage()));
+            ImGui::SameLine();
+
+            if (ImGui::Button("Cancel")) {
+                m_loader.cancel();
+            }
+        }
+
         ImGui::Separator();
 
         ImGui::Spacing();
@@ -321,14 +631,142 @@ void MuhlePlayer::controls() {
 
         ImGui::SameLine();
 
+        if (m_state == State::Analysis) {
+            if (ImGui::Button("Stop Analysis")) {
+                stop_analysis();
+            }
+        } else if ((m_state != State::Ready && m_state != State::Over) || !m_engine) {
+            ImGui::BeginDisabled();
+            ImGui::Button("Analyze");
+            ImGui::EndDisabled();
+        } else {
+            if (ImGui::Button("Analyze")) {
+                start_analysis();
+            }
+        }
+
+        ImGui::SameLine();
+
+        // Finished games can be browsed too, without an engine
+        if (m_state == State::Analysis || m_state == State::Ready || m_state == State::Over) {
+            ImGui::BeginDisabled(m_state != State::Analysis);
+
+            if (ImGui::Button("Take Back")) {
+                take_back();
+            }
+
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+
+            const std::size_t ply {m_board.get_ply()};
+            const std::size_t plies {m_board.get_plies_played()};
+
+            ImGui::BeginDisabled(ply == 0);
+
+            if (ImGui::Button("|<")) {
+                jump(0);
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("<")) {
+                jump(ply - 1);
+            }
+
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::BeginDisabled(ply == plies);
+
+            if (ImGui::Button(">")) {
+                jump(ply + 1);
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button(">|")) {
+                jump(plies);
+            }
+
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::Text("Ply %lu/%lu", ply, plies);
+        }
+
         if (m_state == State::ComputerThinking) {
             ImGui::Text("Thinking...");
+        } else if (m_state == State::ComputerRecovering) {
+            ImGui::Text("Restarting engine...");
+        } else if (m_pondering) {
+            ImGui::Text("Pondering...");
+        } else if (m_state == State::Analysis) {
+            ImGui::Text("Analyzing...");
         } else {
             ImGui::Text("Passive");
         }
 
+        if (m_recoveries > 0) {
+            ImGui::Text("Engine restarts: %u", m_recoveries);
+        }
+
+        if (m_ponder_hits + m_ponder_misses > 0) {
+            ImGui::Text(
+                "Ponder hits: %u/%u (%.0f%%)",
+                m_ponder_hits,
+                m_ponder_hits + m_ponder_misses,
+                100.0 * m_ponder_hits / (m_ponder_hits + m_ponder_misses)
+            );
+        }
+
+        ImGui::Text("FPS: %.0f", m_fps);
+
+        if (m_overhead_moves > 0) {
+            ImGui::Text(
+                "Move overhead: %.1f ms average, %.1f ms max",
+                std::chrono::duration<double, std::milli>(m_overhead_total).count() / m_overhead_moves,
+                std::chrono::duration<double, std::milli>(m_overhead_max).count()
+            );
+        }
+
         ImGui::Spacing();
 
+        ImGui::SliderInt("Move overhead (ms)", &m_move_overhead, 0, 1000);
+
+        if (m_state == State::Ready || m_state == State::Over) {
+            ImGui::SliderInt("Analysis lines", &m_analysis_multipv, 1, 8);
+        } else {
+            ImGui::BeginDisabled();
+            ImGui::SliderInt("Analysis lines", &m_analysis_multipv, 1, 8);
+            ImGui::EndDisabled();
+        }
+
+        // Applied when the game starts
+        ImGui::BeginDisabled(m_state != State::Ready);
+        ImGui::InputInt("Time (s)", &m_time);
+        ImGui::InputInt("Increment (ms)", &m_increment, 100, 1000);
+        ImGui::InputInt("Bronstein delay (ms)", &m_delay, 100, 1000);
+        ImGui::InputInt("Moves per session", &m_moves_per_session);
+        ImGui::EndDisabled();
+
+        m_time = std::clamp(m_time, 1, MAX_TIME);
+        m_increment = std::max(m_increment, 0);
+        m_delay = std::max(m_delay, 0);
+        m_moves_per_session = std::max(m_moves_per_session, 0);
+
+        // Only for games between engines; zero moves disables a rule
+        ImGui::BeginDisabled(m_state != State::Ready);
+        ImGui::InputInt("Resign after moves", &m_resign_moves);
+        ImGui::InputInt("Resign score", &m_resign_score, 100, 1000);
+        ImGui::InputInt("Draw after moves", &m_draw_moves);
+        ImGui::InputInt("Draw score", &m_draw_score);
+        ImGui::InputInt("No draws before ply", &m_draw_ply);
+        ImGui::EndDisabled();
+
+        m_resign_moves = std::max(m_resign_moves, 0);
+        m_resign_score = std::max(m_resign_score, 0);
+        m_draw_moves = std::max(m_draw_moves, 0);
+        m_draw_score = std::max(m_draw_score, 0);
+        m_draw_ply = std::max(m_draw_ply, 0);
+
         ImGui::Text("White");
         ImGui::SameLine();
 
@@ -354,12 +792,44 @@ void MuhlePlayer::controls() {
             ImGui::SameLine();
             ImGui::RadioButton("Computer##b", false);
         }
+
+        ImGui::Separator();
+
+        // Without an engine loaded from a file, the built-in one is used
+        ImGui::BeginDisabled(m_annotator.running());
+        ImGui::InputInt("Annotation engines", &m_annotation_engines);
+        ImGui::InputInt("Annotation time (ms)", &m_annotation_movetime, 100, 1000);
+        ImGui::EndDisabled();
+
+        m_annotation_engines = std::clamp(m_annotation_engines, 1, 64);
+        m_annotation_movetime = std::max(m_annotation_movetime, 1);
+
+        if (m_annotator.running()) {
+            const auto total {std::max(m_annotator.get_total(), std::size_t(1))};
+
+            ImGui::ProgressBar(static_cast<float>(m_annotator.get_completed()) / static_cast<float>(total));
+            ImGui::SameLine();
+
+            if (ImGui::Button("Cancel")) {
+                m_annotator.cancel();
+            }
+        } else {
+            ImGui::BeginDisabled((m_state != State::Ready && m_state != State::Over) || m_moves.empty());
+
+            if (ImGui::Button("Annotate Game")) {
+                start_annotation();
+            }
+
+            ImGui::EndDisabled();
+        }
     }
 
     ImGui::End();
 }
 
 void MuhlePlayer::game() {
+    MUHLE_PROFILE_SCOPE("game");
+
     if (ImGui::Begin("Game")) {
         ImGui::Text("b.");
         ImGui::SameLine();
@@ -371,43 +841,52 @@ void MuhlePlayer::game() {
 
         ImGui::Separator();
 
+        format_info();
+
         ImGui::Text("%s", m_score.c_str());
         ImGui::TextWrapped("%s", m_pv.c_str());
 
-        ImGui::Separator();
+        if (!m_analysis_text.empty()) {
+            ImGui::Separator();
 
-        if (ImGui::BeginChild("Moves")) {
-            if (ImGui::BeginTable("Moves Table", 3)) {
-                if (m_board.get_setup_position().player == board::Player::White) {
-                    for (std::size_t i {0}; i < m_moves.size(); i++) {
-                        if (i % 2 == 0) {
-                            ImGui::TableNextRow();
-                            ImGui::TableSetColumnIndex(0);
-                            ImGui::Text("%lu.", i / 2 + 1);
-                            ImGui::TableSetColumnIndex(1);
-                            ImGui::Text("%s", m_moves[i].c_str());
-                        } else {
-                            ImGui::TableSetColumnIndex(2);
-                            ImGui::Text("%s", m_moves[i].c_str());
-                        }
-                    }
-                } else {
+            if (ImGui::BeginTable("Analysis Table", 4)) {
+                for (std::size_t i {0}; i < m_analysis_text.size(); i++) {
                     ImGui::TableNextRow();
                     ImGui::TableSetColumnIndex(0);
-                    ImGui::Text("%d.", 1);
+                    ImGui::Text("%lu.", i + 1);
                     ImGui::TableSetColumnIndex(1);
-                    ImGui::Text("--/--");
-
-                    for (std::size_t i {0}; i < m_moves.size(); i++) {
-                        if (i % 2 == 0) {
-                            ImGui::TableSetColumnIndex(2);
-                            ImGui::Text("%s", m_moves[i].c_str());
-                        } else {
-                            ImGui::TableNextRow();
-                            ImGui::TableSetColumnIndex(0);
-                            ImGui::Text("%lu.", i / 2 + 2);
-                            ImGui::TableSetColumnIndex(1);
-                            ImGui::Text("%s", m_moves[i].c_str());
+                    ImGui::Text("%u", m_analysis_lines[i].depth);
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%s", m_analysis_text[i].first.c_str());
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::TextWrapped("%s", m_analysis_text[i].second.c_str());
+                }
+
+                ImGui::EndTable();
+            }
+        }
+
+        ImGui::Separator();
+
+        const float graphs_height {(GRAPH_HEIGHT + ImGui::GetStyle().ItemSpacing.y) * 3.0f};
+
+        if (ImGui::BeginChild("Moves", ImVec2(0.0f, -graphs_height))) {
+            update_move_rows();
+
+            if (ImGui::BeginTable("Moves Table", 3)) {
+                // Only the visible rows are submitted
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(m_move_rows.size()));
+
+                while (clipper.Step()) {
+                    for (int i {clipper.DisplayStart}; i < clipper.DisplayEnd; i++) {
+                        const auto& row {m_move_rows[static_cast<std::size_t>(i)]};
+
+                        ImGui::TableNextRow();
+
+                        for (std::size_t j {0}; j < row.size(); j++) {
+                            ImGui::TableSetColumnIndex(static_cast<int>(j));
+                            ImGui::TextUnformatted(row[j].c_str());
                         }
                     }
                 }
@@ -421,24 +900,614 @@ void MuhlePlayer::game() {
         }
 
         ImGui::EndChild();
+
+        graphs();
     }
 
     ImGui::End();
 }
 
-void MuhlePlayer::options() {
-    if (ImGui::Begin("Options")) {
-        if (m_engine) {
-            for (const auto& option : m_engine->get_options()) {
-                ImGui::Text("%s", option.name.c_str());
+void MuhlePlayer::graphs() {
+    const float width {ImGui::GetContentRegionAvail().x};
+
+    // Keep zero in the middle
+    const float score_range {std::max({std::abs(m_score_series.get_min()), std::abs(m_score_series.get_max()), 1.0f})};
+    const std::string score {m_score_series.empty() ? "score" : "score " + std::to_string(static_cast<int>(m_score_series.get_y().back()))};
+
+    ImGui::PlotLines(
+        "##score",
+        m_score_series.get_y().data(),
+        static_cast<int>(m_score_series.size()),
+        0,
+        score.c_str(),
+        -score_range,
+        score_range,
+        ImVec2(width, GRAPH_HEIGHT)
+    );
 
-                // TODO
-            }
-        }
-    }
+    const std::string depth {m_depth_series.empty() ? "depth" : "depth " + std::to_string(static_cast<int>(m_depth_series.get_y().back()))};
+
+    ImGui::PlotLines(
+        "##depth",
+        m_depth_series.get_y().data(),
+        static_cast<int>(m_depth_series.size()),
+        0,
+        depth.c_str(),
+        0.0f,
+        std::max(m_depth_series.get_max(), 1.0f),
+        ImVec2(width, GRAPH_HEIGHT)
+    );
+
+    const std::string nodes {m_nodes_series.empty() ? "nodes" : "nodes " + std::to_string(static_cast<long long>(m_nodes_series.get_y().back()))};
+
+    ImGui::PlotLines(
+        "##nodes",
+        m_nodes_series.get_y().data(),
+        static_cast<int>(m_nodes_series.size()),
+        0,
+        nodes.c_str(),
+        0.0f,
+        std::max(m_nodes_series.get_max(), 1.0f),
+        ImVec2(width, GRAPH_HEIGHT)
+    );
+}
+
+void MuhlePlayer::record_score() {
+    const auto& entry {m_search_history.get_current()};
+
+    if (entry.score_type != search_history::ScoreType::Eval) {
+        return;
+    }
+
+    // From white's side, like the annotations
+    const int score {m_board.get_player() == board::Player::White ? entry.score : -entry.score};
+
+    m_score_series.push(static_cast<float>(m_moves.size()), static_cast<float>(score));
+    m_scores.push_back({m_moves.size(), static_cast<float>(score)});
+}
+
+void MuhlePlayer::clear_search_series() {
+    m_depth_series.clear();
+    m_nodes_series.clear();
+}
+
+void MuhlePlayer::start_annotation() {
+    stop_annotation();
+
+    m_move_annotations.resize(m_moves.size());
+
+    std::vector<annotate::Game> games;
+    games.push_back({board::position_to_string(m_board.get_setup_position()), m_moves});
+
+    m_annotator.start(
+        m_engine_path,
+        m_engine_options,
+        std::move(games),
+        {std::nullopt, static_cast<unsigned int>(m_annotation_movetime)},
+        static_cast<std::size_t>(m_annotation_engines)
+    );
+
+    m_annotating = true;
+}
+
+void MuhlePlayer::stop_annotation() {
+    m_annotator.cancel();
+    m_annotator.finish();
+    m_annotator.poll();
+    m_annotating = false;
+    m_move_annotations.clear();
+    clear_move_rows();
+}
+
+void MuhlePlayer::update_annotation() {
+    MUHLE_PROFILE_SCOPE("update_annotation");
+
+    const bool running {m_annotator.running()};
+    bool changed {false};
+
+    for (const auto& annotation : m_annotator.poll()) {
+        if (annotation.ply > m_move_annotations.size()) {
+            continue;
+        }
+
+        // Scores are given from the side to move; show them from white's side
+        const bool white_to_move {(m_board.get_setup_position().player == board::Player::White) == (annotation.ply % 2 == 0)};
+        const int score {white_to_move ? annotation.entry.score : -annotation.entry.score};
+
+        switch (annotation.entry.score_type) {
+            case search_history::ScoreType::None:
+                break;
+            case search_history::ScoreType::Eval:
+                m_move_annotations[annotation.ply - 1] = (score > 0 ? "+" : "") + std::to_string(score);
+                break;
+            case search_history::ScoreType::Win:
+                m_move_annotations[annotation.ply - 1] = (score > 0 ? "#+" : "#") + std::to_string(score);
+                break;
+        }
+
+        changed = true;
+    }
+
+    if (changed) {
+        clear_move_rows();
+    }
+
+    if (!running && m_annotating) {
+        m_annotator.finish();
+        m_annotating = false;
+
+        const auto error {m_annotator.get_error()};
+
+        if (!error.empty()) {
+            std::cerr << "Could not annotate game: " << error << '\n';
+        }
+    }
+}
+
+void MuhlePlayer::update_move_rows() {
+    // Rows are only appended; taking back moves clears them
+    if (m_move_rows.empty() && m_board.get_setup_position().player == board::Player::Black) {
+        m_move_rows.push_back({"1.", "--/--", ""});
+    }
+
+    const std::size_t first {m_board.get_setup_position().player == board::Player::White ? 0u : 1u};
+
+    for (; m_move_rows_plies < m_moves.size(); m_move_rows_plies++) {
+        const std::size_t index {m_move_rows_plies + first};
+
+        std::string move {m_moves[m_move_rows_plies]};
+
+        if (m_move_rows_plies < m_move_annotations.size() && !m_move_annotations[m_move_rows_plies].empty()) {
+            move += "  " + m_move_annotations[m_move_rows_plies];
+        }
+
+        if (index % 2 == 0) {
+            m_move_rows.push_back({std::to_string(index / 2 + 1) + ".", std::move(move), ""});
+        } else {
+            m_move_rows.back()[2] = std::move(move);
+        }
+    }
+}
+
+void MuhlePlayer::clear_move_rows() {
+    m_move_rows.clear();
+    m_move_rows_plies = 0;
+}
+
+void MuhlePlayer::options() {
+    MUHLE_PROFILE_SCOPE("options");
+
+    if (ImGui::Begin("Options")) {
+        if (m_engine) {
+            for (const auto& option : m_engine->get_options()) {
+                ImGui::Text("%s", option.name.c_str());
+
+                // TODO
+            }
+        }
+    }
+
+    ImGui::End();
+}
+
+#ifdef MUHLE_PROFILER
+void MuhlePlayer::frame_profile() {
+    const profiler::Profiler& instance {profiler::Profiler::get()};
+
+    if (ImGui::Begin("Profiler")) {
+        ImGui::Text("Last frame: %.2f ms", instance.get_last_frame_time());
+
+        // The last frame, one row per nesting level
+        const auto& records {instance.get_last_frame()};
+        int depths {1};
+
+        for (const auto& record : records) {
+            depths = std::max(depths, record.depth + 1);
+        }
+
+        ImDrawList* draw_list {ImGui::GetWindowDrawList()};
+        const ImVec2 origin {ImGui::GetCursorScreenPos()};
+        const float width {std::max(ImGui::GetContentRegionAvail().x, 1.0f)};
+        const float row_height {ImGui::GetTextLineHeight() + 2.0f};
+        const float scale {width / std::max(instance.get_last_frame_time(), 0.001f)};
+
+        for (const auto& record : records) {
+            const ImVec2 min {origin.x + record.begin * scale, origin.y + static_cast<float>(record.depth) * row_height};
+            const ImVec2 max {std::max(origin.x + record.end * scale, min.x + 1.0f), min.y + row_height - 1.0f};
+
+            // Same name, same color, from frame to frame
+            unsigned int hash {2166136261u};
+
+            for (const char* c {record.name}; *c != '\0'; c++) {
+                hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+            }
+
+            draw_list->AddRectFilled(
+                min,
+                max,
+                ImColor(
+                    static_cast<int>(110u + hash % 120u),
+                    static_cast<int>(110u + hash / 120u % 120u),
+                    static_cast<int>(110u + hash / 14400u % 120u)
+                )
+            );
+
+            if (ImGui::CalcTextSize(record.name).x < max.x - min.x - 2.0f) {
+                draw_list->AddText(ImVec2(min.x + 1.0f, min.y + 1.0f), ImColor(15, 15, 15), record.name);
+            }
+        }
+
+        ImGui::Dummy(ImVec2(width, static_cast<float>(depths) * row_height));
+
+        if (ImGui::BeginTable("Sections", 4, ImGuiTableFlags_Borders)) {
+            ImGui::TableSetupColumn("Section");
+            ImGui::TableSetupColumn("Min (ms)");
+            ImGui::TableSetupColumn("Avg (ms)");
+            ImGui::TableSetupColumn("P99 (ms)");
+            ImGui::TableHeadersRow();
+
+            for (const auto& statistics : instance.get_statistics()) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", statistics.name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", statistics.min);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", statistics.avg);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", statistics.p99);
+            }
+
+            ImGui::EndTable();
+        }
+    }
 
     ImGui::End();
 }
+#endif
+
+void MuhlePlayer::position_search() {
+    MUHLE_PROFILE_SCOPE("position_search");
+
+    if (m_index_thread.joinable() && !m_index_building) {
+        m_index_thread.join();
+        save_pending_games();
+        open_position_index();
+    }
+
+    if (ImGui::Begin("Position Search")) {
+        ImGui::Text("Database: %s", GAMES_FILE_PATH);
+
+        ImGui::BeginDisabled(m_index_building);
+
+        if (ImGui::Button("Build Index")) {
+            build_position_index();
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Search")) {
+            search_position();
+        }
+
+        ImGui::EndDisabled();
+
+        if (m_index_building) {
+            ImGui::Text("Building index...");
+        } else if (!m_search_error.empty()) {
+            ImGui::TextWrapped("%s", m_search_error.c_str());
+        } else if (m_position_index_open) {
+            ImGui::Text("%lu games, %lu positions", m_position_index.get_games(), m_position_index.size());
+            ImGui::Text("Found %lu games in %.3f ms", m_search_results.size(), m_search_time);
+        }
+
+        ImGui::Separator();
+
+        const bool can_load {m_state == State::Ready || m_state == State::Over};
+
+        if (ImGui::BeginChild("Results")) {
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(m_search_results.size()));
+
+            while (clipper.Step()) {
+                for (int i {clipper.DisplayStart}; i < clipper.DisplayEnd; i++) {
+                    const std::size_t game {m_search_results[static_cast<std::size_t>(i)]};
+
+                    ImGui::PushID(i);
+
+                    if (ImGui::Selectable(format_search_result(game).c_str(), false, can_load ? 0 : ImGuiSelectableFlags_Disabled)) {
+                        load_game(game);
+                    }
+
+                    ImGui::PopID();
+                }
+            }
+        }
+
+        ImGui::EndChild();
+    }
+
+    ImGui::End();
+}
+
+void MuhlePlayer::build_position_index() {
+    close_games_file();
+
+    m_position_index.close();
+    m_position_index_open = false;
+    m_search_records.close();
+    m_search_results.clear();
+    m_search_error.clear();
+    m_index_building = true;
+
+    m_index_thread = std::thread([this]() {
+        try {
+            position_index::build(GAMES_FILE_PATH, std::string(GAMES_FILE_PATH) + ".index");
+        } catch (const position_index::PositionIndexError& e) {
+            m_index_error = e.what();
+        }
+
+        m_index_building = false;
+        glfwPostEmptyEvent();
+    });
+}
+
+void MuhlePlayer::open_position_index() {
+    m_search_error = std::exchange(m_index_error, {});
+
+    if (!m_search_error.empty()) {
+        return;
+    }
+
+    try {
+        m_position_index.open(std::string(GAMES_FILE_PATH) + ".index");
+        m_search_records.open(GAMES_FILE_PATH);
+    } catch (const position_index::PositionIndexError& e) {
+        m_search_error = e.what();
+        return;
+    } catch (const record::RecordError& e) {
+        m_search_error = e.what();
+        return;
+    }
+
+    m_position_index_open = true;
+}
+
+void MuhlePlayer::search_position() {
+    if (!m_position_index_open) {
+        open_position_index();
+
+        if (!m_position_index_open) {
+            return;
+        }
+    }
+
+    const int p {m_twelve_mens_morris ? board::TWELVE : board::NINE};
+
+    const auto begin {std::chrono::steady_clock::now()};
+    m_search_results = m_position_index.find(m_board.get_position(), p);
+    const auto end {std::chrono::steady_clock::now()};
+
+    m_search_time = std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+std::string MuhlePlayer::format_search_result(std::size_t game) const {
+    std::string result {"#" + std::to_string(game + 1)};
+
+    try {
+        const record::GameHeader header {m_search_records.get_header(game)};
+
+        switch (header.result) {
+            case board::GameOver::None:
+                result += "  *";
+                break;
+            case board::GameOver::WinnerWhite:
+                result += "  1-0";
+                break;
+            case board::GameOver::WinnerBlack:
+                result += "  0-1";
+                break;
+            case board::GameOver::Draw:
+                result += "  1/2-1/2";
+                break;
+        }
+
+        switch (header.termination) {
+            case record::Termination::Normal:
+                break;
+            case record::Termination::Adjudication:
+                result += " (adjudication)";
+                break;
+            case record::Termination::Forfeit:
+                result += " (forfeit)";
+                break;
+        }
+
+        result += "  " + std::to_string(header.moves) + " plies";
+    } catch (const record::RecordError&) {
+        result += "  (index out of date)";
+    }
+
+    return result;
+}
+
+void MuhlePlayer::load_game(std::size_t game) {
+    record::Game record;
+
+    try {
+        record = m_search_records.get_game(game);
+    } catch (const record::RecordError& e) {
+        std::cerr << "Could not load game: " << e.what() << '\n';
+        return;
+    }
+
+    if ((record.header.variant == record::Variant::TwelveMensMorris) != m_twelve_mens_morris) {
+        std::cerr << "Could not load game: different variant\n";
+        return;
+    }
+
+    reset_position(board::position_to_string(record.header.setup));
+
+    // Replay the game without notifying anyone
+    m_replaying = true;
+
+    try {
+        for (const board::Move& move : record.moves) {
+            m_board.play_move(move);
+        }
+    } catch (const board::BoardError& e) {
+        std::cerr << "Could not load game: " << e.what() << '\n';
+    }
+
+    m_replaying = false;
+}
+
+void MuhlePlayer::format_info() {
+    if (!m_info_dirty) {
+        return;
+    }
+
+    const auto& entry {m_search_history.get_current()};
+
+    if (entry.score_type != search_history::ScoreType::None) {
+        m_score = search_history::SearchHistory::score_to_string(entry);
+    }
+
+    // A new depth starts without a PV, which shouldn't blank the last one
+    if (entry.pv_size > 0) {
+        m_pv = search_history::SearchHistory::pv_to_string(entry);
+    }
+
+    m_analysis_text.resize(m_analysis_lines.size());
+
+    for (std::size_t i {0}; i < m_analysis_lines.size(); i++) {
+        m_analysis_text[i].first = search_history::SearchHistory::score_to_string(m_analysis_lines[i]);
+        m_analysis_text[i].second = search_history::SearchHistory::pv_to_string(m_analysis_lines[i]);
+    }
+
+    m_info_dirty = false;
+}
+
+void MuhlePlayer::wait_for_events() {
+    const auto now {std::chrono::steady_clock::now()};
+
+    m_frames++;
+
+    if (now - m_frames_time >= std::chrono::seconds(1)) {
+        m_fps = static_cast<float>(m_frames) / std::chrono::duration<float>(now - m_frames_time).count();
+        m_frames = 0;
+        m_frames_time = now;
+    }
+
+    // ImGui needs another frame to react to the input of the previous one
+    if (m_board.is_animating() || m_settle_frames > 0) {
+        m_settle_frames = std::max(m_settle_frames - 1, 0);
+        return;
+    }
+
+    // The clock is displayed with centiseconds; otherwise wake up now and then anyway
+    const std::chrono::duration<double> timeout {m_clock.is_running() ? 0.01 : 0.5};
+
+    {
+        trace::Span span {"wait_for_events"};
+        glfwWaitEventsTimeout(timeout.count());
+    }
+
+    if (std::chrono::steady_clock::now() - now < timeout) {
+        m_settle_frames = SETTLE_FRAMES;
+    }
+}
+
+void MuhlePlayer::schedule_timeout() {
+    const auto deadline {m_clock.get_deadline()};
+
+    if (!deadline) {
+        m_timer.cancel();
+        return;
+    }
+
+    engine::Engine* engine {m_engine.get()};
+
+    m_timer.schedule(*deadline, [this, engine]() {
+        // This is called on the timer thread
+        m_timeout = true;
+
+        if (engine != nullptr) {
+            engine->request_stop();
+        }
+
+        glfwPostEmptyEvent();
+    });
+}
+
+void MuhlePlayer::check_timeout() {
+    const auto deadline {m_clock.get_deadline()};
+
+    if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+        flag();
+    }
+}
+
+void MuhlePlayer::flag() {
+    m_referee.flag(m_board);
+
+    stop_pondering();
+
+    if (m_engine && m_state == State::ComputerThinking) {
+        try {
+            m_engine->stop_thinking();
+        } catch (const engine::EngineError& e) {
+            engine_error(e);
+        }
+    }
+
+    m_state = State::Stop;
+}
+
+void MuhlePlayer::record_overhead() {
+    assert(m_engine);
+
+    const auto now {std::chrono::steady_clock::now()};
+
+    // Time from the start of the turn until the engine was told to go, plus
+    // the time from the engine's move being read until it was applied
+    auto overhead {now - m_engine->get_best_move_time()};
+
+    if (m_engine->get_go_time() > m_turn_start) {
+        overhead += m_engine->get_go_time() - m_turn_start;
+    }
+
+    m_overhead_moves++;
+    m_overhead_total += overhead;
+    m_overhead_max = std::max(m_overhead_max, overhead);
+}
+
+unsigned int MuhlePlayer::subtract_move_overhead(unsigned int time) const {
+    const auto move_overhead {static_cast<unsigned int>(m_move_overhead)};
+
+    return time > move_overhead ? time - move_overhead : 0;
+}
+
+clock_::TimeControl MuhlePlayer::get_time_control() const {
+    clock_::TimeControl time_control;
+    time_control.time = static_cast<unsigned int>(m_time) * 1000;
+    time_control.increment = static_cast<unsigned int>(m_increment);
+    time_control.delay = static_cast<unsigned int>(m_delay);
+    time_control.moves = static_cast<unsigned int>(m_moves_per_session);
+
+    return time_control;
+}
+
+adjudication::Settings MuhlePlayer::get_adjudication() const {
+    adjudication::Settings settings;
+    settings.resign_moves = static_cast<unsigned int>(m_resign_moves);
+    settings.resign_score = m_resign_score;
+    settings.draw_moves = static_cast<unsigned int>(m_draw_moves);
+    settings.draw_score = m_draw_score;
+    settings.draw_ply = static_cast<unsigned int>(m_draw_ply);
+
+    return settings;
+}
 
 int MuhlePlayer::get_board_player_type() const {
     switch (m_board.get_player()) {
@@ -461,6 +1530,8 @@ void MuhlePlayer::assert_engine_game_over() {
             std::nullopt,
             std::nullopt,
             std::nullopt,
+            std::nullopt,
+            std::nullopt,
             100
         );
 
@@ -485,7 +1556,95 @@ void MuhlePlayer::assert_engine_game_over() {
 
 void MuhlePlayer::engine_error(const engine::EngineError& e) {
     std::cerr << "Engine error: " << e.what() << '\n';
+    m_timer.cancel();  // It may refer to the engine
     m_engine.reset();
+    m_pondering = false;
+
+    schedule_timeout();
+
+    const bool recoverable {m_game_recoveries < MAX_GAME_RECOVERIES};
+
+    if (!recoverable) {
+        std::cerr << "The engine has crashed too many times; not restarting it\n";
+    }
+
+    if (!m_engine_path.empty() && !m_loader.loading() && recoverable) {
+        // Respawn the engine and restore its state; the game continues once it is ready
+        m_loader.finish();
+        m_loader.load(m_engine_path, m_engine_options);
+        m_recovery_deadline = std::chrono::steady_clock::now() + RECOVERY_TIME_BUDGET;
+        m_recoveries++;
+        m_game_recoveries++;
+
+        if (m_state == State::ComputerStartThinking || m_state == State::ComputerThinking) {
+            m_state = State::ComputerRecovering;
+        }
+
+        return;
+    }
+
+    switch (m_state) {
+        case State::Ready:
+        case State::Stop:
+        case State::Over:
+            break;
+        case State::Analysis:
+            m_state = State::Ready;
+            break;
+        default:
+            // Humans can go on without the engine
+            if (m_white == PlayerComputer || m_black == PlayerComputer) {
+                forfeit_engine(e.what());
+            }
+
+            break;
+    }
+}
+
+void MuhlePlayer::forfeit_engine(const std::string& reason) {
+    // With a human to move, the engine was pondering on the other side
+    const auto player {
+        get_board_player_type() == PlayerComputer ? m_board.get_player() : board::Board::opponent(m_board.get_player())
+    };
+
+    m_referee.forfeit(m_board, player, reason);
+    m_state = State::Stop;
+}
+
+void MuhlePlayer::check_engine_alive() {
+    if (!m_engine) {
+        return;
+    }
+
+    try {
+        if (!m_engine->alive()) {
+            throw engine::EngineError("Engine process has exited");
+        }
+    } catch (const engine::EngineError& e) {
+        engine_error(e);
+    }
+}
+
+void MuhlePlayer::set_engine_option(const std::string& name, const std::optional<std::string>& value) {
+    assert(m_engine);
+
+    try {
+        m_engine->set_option(name, value);
+    } catch (const engine::EngineError& e) {
+        engine_error(e);
+        return;
+    }
+
+    // Remember the option, in case the engine needs to be restarted
+    const auto iter {std::find_if(m_engine_options.begin(), m_engine_options.end(), [&](const auto& option) {
+        return option.first == name;
+    })};
+
+    if (iter != m_engine_options.end()) {
+        iter->second = value;
+    } else {
+        m_engine_options.emplace_back(name, value);
+    }
 }
 
 void MuhlePlayer::set_twelve_mens_morris() {
@@ -499,12 +1658,239 @@ void MuhlePlayer::set_twelve_mens_morris() {
         throw std::runtime_error("Engine doesn't support twelve men's morris");
     }
 
+    set_engine_option("TwelveMensMorris", m_twelve_mens_morris ? "true" : "false");
+
+    m_board.twelve_mens_morris(m_twelve_mens_morris);
+}
+
+void MuhlePlayer::set_ponder() {
+    assert(m_engine);
+
+    const auto iter {std::find_if(m_engine->get_options().cbegin(), m_engine->get_options().cend(), [](const auto& option) {
+        return option.name == "Ponder";
+    })};
+
+    if (iter == m_engine->get_options().cend()) {
+        return;  // Pondering is part of the protocol; the option only tells the engine to manage its time accordingly
+    }
+
+    set_engine_option("Ponder", m_ponder ? "true" : "false");
+}
+
+void MuhlePlayer::start_pondering() {
+    if (!m_ponder || !m_engine) {
+        return;
+    }
+
+    const auto& ponder_move {m_engine->get_ponder_move()};
+
+    if (!ponder_move) {
+        return;
+    }
+
     try {
-        m_engine->set_option("TwelveMensMorris", m_twelve_mens_morris ? "true" : "false");
+        board::move_from_string(*ponder_move);
+    } catch (const board::BoardError&) {
+        return;
+    }
+
+    clear_search_series();
+
+    try {
+        m_engine->start_pondering(
+            board::position_to_string(m_board.get_setup_position()),
+            m_moves,
+            *ponder_move,
+            subtract_move_overhead(m_clock.get_white_time()),
+            subtract_move_overhead(m_clock.get_black_time()),
+            m_clock.get_engine_increment(),
+            m_clock.get_engine_increment()
+        );
     } catch (const engine::EngineError& e) {
         engine_error(e);
         return;
     }
 
-    m_board.twelve_mens_morris(m_twelve_mens_morris);
+    m_ponder_move = *ponder_move;
+    m_pondering = true;
+    m_ponder_ended = false;
+}
+
+void MuhlePlayer::stop_pondering() {
+    if (!m_pondering) {
+        return;
+    }
+
+    m_pondering = false;
+
+    assert(m_engine);
+
+    try {
+        m_engine->stop_thinking();
+    } catch (const engine::EngineError& e) {
+        engine_error(e);
+    }
+}
+
+void MuhlePlayer::start_analysis() {
+    assert(m_engine);
+
+    const auto iter {std::find_if(m_engine->get_options().cbegin(), m_engine->get_options().cend(), [](const auto& option) {
+        return option.name == "MultiPV";
+    })};
+
+    if (iter != m_engine->get_options().cend()) {
+        set_engine_option("MultiPV", std::to_string(m_analysis_multipv));
+    }
+
+    if (!m_engine) {
+        return;
+    }
+
+    m_state = State::Analysis;
+    m_game_recoveries = 0;
+
+    restart_analysis();
+}
+
+void MuhlePlayer::restart_analysis() {
+    m_analysis_lines.clear();
+    m_info_dirty = true;
+    clear_search_series();
+
+    if (!m_engine) {
+        return;  // Restarted when the engine comes back
+    }
+
+    // Don't wait for the best move of the previous search; the engine discards it
+    try {
+        m_engine->stop_thinking();
+
+        if (m_board.get_game_over() == board::GameOver::None) {
+            // The engine gets the moves up to the ply shown, not the whole line
+            const std::vector<std::string> moves(m_moves.begin(), m_moves.begin() + static_cast<std::ptrdiff_t>(m_board.get_ply()));
+
+            m_engine->start_analysis(board::position_to_string(m_board.get_setup_position()), moves);
+        }
+    } catch (const engine::EngineError& e) {
+        engine_error(e);
+    }
+}
+
+void MuhlePlayer::stop_analysis() {
+    if (m_engine) {
+        try {
+            m_engine->stop_thinking();
+        } catch (const engine::EngineError& e) {
+            engine_error(e);
+        }
+    }
+
+    // The rest of the line is kept until a game is started or a move is played from here
+    m_state = State::Ready;
+}
+
+void MuhlePlayer::update_analysis_line(unsigned int multipv, const engine::Engine::Info& info) {
+    if (multipv < 1 || multipv > 64) {
+        return;
+    }
+
+    if (m_analysis_lines.size() < multipv) {
+        m_analysis_lines.resize(multipv);
+    }
+
+    search_history::SearchHistory::merge(m_analysis_lines[multipv - 1], info);
+}
+
+void MuhlePlayer::save_game() {
+    if (m_moves.empty()) {
+        return;
+    }
+
+    m_pending_games.push_back(m_referee.make_record(m_board, m_moves, m_twelve_mens_morris));
+
+    // The file must not change while it's being indexed; the game is saved once that is done
+    if (!m_index_building) {
+        save_pending_games();
+    }
+}
+
+void MuhlePlayer::save_pending_games() {
+    if (m_pending_games.empty()) {
+        return;
+    }
+
+    // The file is about to change under the mapping
+    m_search_records.close();
+    m_position_index.close();
+    m_position_index_open = false;
+    m_search_results.clear();
+
+    try {
+        if (!m_games_writer.is_open()) {
+            m_games_writer.open(GAMES_FILE_PATH);
+        }
+
+        for (const auto& game : m_pending_games) {
+            m_games_writer.append(game.header, game.moves);
+        }
+    } catch (const record::RecordError& e) {
+        std::cerr << "Could not save game: " << e.what() << '\n';
+    }
+
+    m_pending_games.clear();
+}
+
+void MuhlePlayer::close_games_file() {
+    // Readers need the index at the end of the file
+    try {
+        m_games_writer.close();
+    } catch (const record::RecordError& e) {
+        std::cerr << "Could not save games: " << e.what() << '\n';
+    }
+}
+
+void MuhlePlayer::take_back() {
+    if (m_board.get_ply() == 0) {
+        return;
+    }
+
+    m_board.take_back();
+    truncate_moves(m_board.get_ply());
+
+    restart_analysis();
+}
+
+void MuhlePlayer::jump(std::size_t ply) {
+    if (ply == m_board.get_ply() || ply > m_board.get_plies_played()) {
+        return;
+    }
+
+    m_board.jump(ply);
+
+    if (m_state == State::Analysis) {
+        restart_analysis();
+    }
+}
+
+void MuhlePlayer::truncate_moves(std::size_t plies) {
+    if (m_moves.size() <= plies) {
+        return;
+    }
+
+    m_moves.resize(plies);
+
+    // The annotations in progress refer to the old moves
+    stop_annotation();
+
+    // Only the scores of positions whose move is still played are kept; the series can't be cut, so it's rebuilt
+    m_scores.erase(std::remove_if(m_scores.begin(), m_scores.end(), [plies](const auto& score) {
+        return score.first >= plies;
+    }), m_scores.end());
+
+    m_score_series.clear();
+
+    for (const auto& [ply, score] : m_scores) {
+        m_score_series.push(static_cast<float>(ply), score);
+    }
 }
@@ -2,14 +2,30 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <optional>
 #include <memory>
+#include <utility>
+#include <chrono>
+#include <atomic>
+#include <thread>
 
 #include <gui_base/gui_base.hpp>
 
 #include "board.hpp"
 #include "engine.hpp"
+#include "builtin_engine.hpp"
 #include "clock.hpp"
+#include "timer.hpp"
+#include "search_history.hpp"
+#include "loader.hpp"
+#include "record.hpp"
+#include "referee.hpp"
+#include "position_index.hpp"
+#include "annotate.hpp"
+#include "time_series.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
 
 class MuhlePlayer : public gui_base::GuiApplication {
 public:
@@ -21,6 +37,9 @@ public:
     void stop() override;
 private:
     void load_engine(const std::string& file_path);
+    void load_builtin_engine();
+    void update_loader();
+    void use_engine(std::unique_ptr<engine::Engine>&& engine);
     void unload_engine();
 
     void main_menu_bar();
@@ -32,12 +51,54 @@ private:
     void board();
     void controls();
     void game();
+    void graphs();
+    void record_score();
+    void clear_search_series();
+    void start_annotation();
+    void stop_annotation();
+    void update_annotation();
+    void update_move_rows();
+    void clear_move_rows();
     void options();
+#ifdef MUHLE_PROFILER
+    void frame_profile();
+#endif
+    void position_search();
+    void build_position_index();
+    void open_position_index();
+    void search_position();
+    std::string format_search_result(std::size_t game) const;
+    void load_game(std::size_t game);
+    void format_info();
+    void wait_for_events();
+    void schedule_timeout();
+    void check_timeout();
+    void flag();
+    void record_overhead();
+    unsigned int subtract_move_overhead(unsigned int time) const;
+    clock_::TimeControl get_time_control() const;
+    adjudication::Settings get_adjudication() const;
 
     int get_board_player_type() const;
     void assert_engine_game_over();
     void engine_error(const engine::EngineError& e);
+    void forfeit_engine(const std::string& reason);
+    void check_engine_alive();
+    void set_engine_option(const std::string& name, const std::optional<std::string>& value);
     void set_twelve_mens_morris();
+    void set_ponder();
+    void start_analysis();
+    void restart_analysis();
+    void stop_analysis();
+    void update_analysis_line(unsigned int multipv, const engine::Engine::Info& info);
+    void save_game();
+    void save_pending_games();
+    void close_games_file();
+    void take_back();
+    void jump(std::size_t ply);
+    void truncate_moves(std::size_t plies);
+    void start_pondering();
+    void stop_pondering();
 
     enum PlayerType {
         PlayerHuman,
@@ -45,7 +106,22 @@ private:
     };
 
     board::Board m_board;
+    referee::Referee m_referee;
     std::unique_ptr<engine::Engine> m_engine;
+    loader::EngineLoader m_loader;
+
+    // Every finished game is appended here
+    static constexpr const char* GAMES_FILE_PATH {"muhle_player.games"};
+    static constexpr const char* TRACE_FILE_PATH {"muhle_player.trace.json"};
+
+    static constexpr auto RECOVERY_TIME_BUDGET {std::chrono::seconds(12)};
+    static constexpr unsigned int MAX_GAME_RECOVERIES {3};  // An engine crashing on the same position is given up on
+
+    std::string m_engine_path;
+    std::vector<std::pair<std::string, std::optional<std::string>>> m_engine_options;
+    std::chrono::steady_clock::time_point m_recovery_deadline;
+    unsigned int m_recoveries {0};
+    unsigned int m_game_recoveries {0};  // Since the game or the analysis started
 
     int m_white {PlayerHuman};
     int m_black {PlayerComputer};
@@ -57,14 +133,89 @@ private:
         HumanThinking,
         ComputerStartThinking,
         ComputerThinking,
+        ComputerRecovering,
         Stop,
-        Over
+        Over,
+        Analysis
     } m_state {State::Ready};
 
     std::vector<std::string> m_moves;
+    std::vector<std::array<std::string, 3>> m_move_rows;  // Formatted for the moves table
+    std::size_t m_move_rows_plies {0};
+
+    annotate::Annotator m_annotator;
+    bool m_annotating {false};
+    std::vector<std::string> m_move_annotations;  // Scores per ply, from white's side
+    int m_annotation_engines {4};
+    int m_annotation_movetime {1000};
+
+    // Score per ply of the game, and depth and nodes over the current search
+    static constexpr float GRAPH_HEIGHT {60.0f};
+    time_series::TimeSeries m_score_series;
+    std::vector<std::pair<std::size_t, float>> m_scores;  // Ply and score, to rebuild the series after a take back
+    time_series::TimeSeries m_depth_series;
+    time_series::TimeSeries m_nodes_series;
+    search_history::SearchHistory m_search_history;
+    bool m_info_dirty {false};
     std::string m_score;
     std::string m_pv;
+
+    int m_analysis_multipv {3};
+    std::vector<search_history::Entry> m_analysis_lines;
+    std::vector<std::pair<std::string, std::string>> m_analysis_text;
+    bool m_replaying {false};
     clock_::Clock m_clock;
+    timer::Timer m_timer;
+    std::atomic<bool> m_timeout {false};
+
+    // Time control settings; the time is in seconds, the rest in milliseconds
+    int m_time {180};
+    int m_increment {0};
+    int m_delay {0};
+    int m_moves_per_session {0};
+    static constexpr int MAX_TIME {36000};  // Keeps the milliseconds within unsigned int
+
+    // Adjudication settings of engine games; the scores are evaluations as the engines report them
+    int m_resign_moves {0};
+    int m_resign_score {1000};
+    int m_draw_moves {0};
+    int m_draw_score {10};
+    int m_draw_ply {60};
+
+    // The engine is told that it has this much less time, to account for the communication
+    int m_move_overhead {20};
+    std::chrono::steady_clock::time_point m_turn_start;
+    std::chrono::steady_clock::time_point m_input_time;  // When the board last took user input
+    unsigned int m_overhead_moves {0};
+    std::chrono::steady_clock::duration m_overhead_total {};
+    std::chrono::steady_clock::duration m_overhead_max {};
 
     bool m_twelve_mens_morris {false};
+
+    // Searching the games database by position
+    position_index::PositionIndex m_position_index;
+    record::RecordReader m_search_records;
+    bool m_position_index_open {false};
+    std::vector<std::size_t> m_search_results;
+    double m_search_time {};
+    std::string m_search_error;
+    std::thread m_index_thread;
+    std::atomic<bool> m_index_building {false};
+    std::string m_index_error;  // Set by the index thread
+    std::vector<record::Game> m_pending_games;  // Finished while the index was being built
+    record::RecordWriter m_games_writer;  // Kept open, since closing writes the whole index again
+
+    // Only draw when something changes
+    static constexpr int SETTLE_FRAMES {2};
+    int m_settle_frames {SETTLE_FRAMES};
+    unsigned int m_frames {0};
+    std::chrono::steady_clock::time_point m_frames_time;
+    float m_fps {0.0f};
+
+    bool m_ponder {false};
+    bool m_pondering {false};
+    bool m_ponder_ended {false};  // The engine gave a best move while pondering, so a hit can't be used
+    std::string m_ponder_move;
+    unsigned int m_ponder_hits {0};
+    unsigned int m_ponder_misses {0};
 };
@@ -0,0 +1,440 @@
+#include "plugin_engine.hpp"
+
+#include <filesystem>
+#include <algorithm>
+#include <utility>
+#include <cctype>
+
+#include "profiler.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <dlfcn.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace engine {
+    static void* open_library(const std::string& file_path) {
+#ifdef _WIN32
+        void* library {reinterpret_cast<void*>(LoadLibraryA(file_path.c_str()))};
+
+        if (library == nullptr) {
+            throw EngineError("Could not load library: error " + std::to_string(GetLastError()));
+        }
+#else
+        void* library {dlopen(file_path.c_str(), RTLD_NOW | RTLD_LOCAL)};
+
+        if (library == nullptr) {
+            throw EngineError("Could not load library: "s + dlerror());
+        }
+#endif
+
+        return library;
+    }
+
+    static void* find_symbol(void* library, const char* name) {
+#ifdef _WIN32
+        return reinterpret_cast<void*>(GetProcAddress(reinterpret_cast<HMODULE>(library), name));
+#else
+        return dlsym(library, name);
+#endif
+    }
+
+    static void close_library(void* library) {
+#ifdef _WIN32
+        FreeLibrary(reinterpret_cast<HMODULE>(library));
+#else
+        dlclose(library);
+#endif
+    }
+
+    PluginEngine::~PluginEngine() {
+        if (m_instance != nullptr) {
+            uninitialize();
+        }
+
+        if (m_library != nullptr) {
+            close_library(m_library);
+        }
+    }
+
+    void PluginEngine::initialize(const std::string& file_path, const std::optional<Capabilities>&) {
+        m_library = open_library(file_path);
+
+        const auto entry {reinterpret_cast<MuhleEnginePluginEntry>(find_symbol(m_library, MUHLE_ENGINE_PLUGIN_ENTRY))};
+
+        if (entry == nullptr) {
+            throw EngineError("Library is not an engine plugin");
+        }
+
+        m_plugin = entry();
+
+        if (m_plugin == nullptr || m_plugin->abi_version != MUHLE_ENGINE_PLUGIN_ABI_VERSION) {
+            throw EngineError("Engine plugin has an incompatible interface");
+        }
+
+        m_name = m_plugin->name != nullptr ? m_plugin->name : "";
+        m_author = m_plugin->author != nullptr ? m_plugin->author : "";
+
+        for (unsigned int i {0}; i < m_plugin->options_size; i++) {
+            m_options.push_back(convert_option(m_plugin->options[i]));
+        }
+
+        m_instance = m_plugin->create(info_callback, best_move_callback, this);
+
+        if (m_instance == nullptr) {
+            throw EngineError("Could not create engine instance");
+        }
+    }
+
+    void PluginEngine::set_debug(bool) {}
+
+    void PluginEngine::synchronize() {
+        // Every call returns only after it's processed
+    }
+
+    void PluginEngine::set_option(const std::string& name, const std::optional<std::string>& value) {
+        if (m_plugin->set_option(m_instance, name.c_str(), value ? value->c_str() : nullptr) != 0) {
+            throw EngineError("Could not set option " + name);
+        }
+    }
+
+    void PluginEngine::new_game() {
+        if (m_plugin->new_game(m_instance) != 0) {
+            throw EngineError("Could not start a new game");
+        }
+
+        m_ponder_move.reset();
+        m_expected_reply.reset();
+    }
+
+    void PluginEngine::start_thinking(
+        const std::optional<std::string>& position,
+        const std::vector<std::string>& moves,
+        std::optional<unsigned int> wtime,
+        std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc,
+        std::optional<unsigned int> depth,
+        std::optional<unsigned int> movetime
+    ) {
+        MuhleGo parameters {};
+
+        if (wtime) {
+            parameters.flags |= MUHLE_GO_WTIME;
+            parameters.wtime = *wtime;
+        }
+
+        if (btime) {
+            parameters.flags |= MUHLE_GO_BTIME;
+            parameters.btime = *btime;
+        }
+
+        if (winc) {
+            parameters.flags |= MUHLE_GO_WINC;
+            parameters.winc = *winc;
+        }
+
+        if (binc) {
+            parameters.flags |= MUHLE_GO_BINC;
+            parameters.binc = *binc;
+        }
+
+        if (depth) {
+            parameters.flags |= MUHLE_GO_DEPTH;
+            parameters.depth = *depth;
+        }
+
+        if (movetime) {
+            parameters.flags |= MUHLE_GO_MOVETIME;
+            parameters.movetime = *movetime;
+        }
+
+        go(position, moves, parameters);
+
+        m_go_time = std::chrono::steady_clock::now();
+    }
+
+    void PluginEngine::start_pondering(
+        const std::optional<std::string>& position,
+        const std::vector<std::string>& moves,
+        const std::string& ponder_move,
+        std::optional<unsigned int> wtime,
+        std::optional<unsigned int> btime,
+        std::optional<unsigned int> winc,
+        std::optional<unsigned int> binc
+    ) {
+        auto ponder_moves {moves};
+        ponder_moves.push_back(ponder_move);
+
+        MuhleGo parameters {};
+        parameters.flags |= MUHLE_GO_PONDER;
+
+        if (wtime) {
+            parameters.flags |= MUHLE_GO_WTIME;
+            parameters.wtime = *wtime;
+        }
+
+        if (btime) {
+            parameters.flags |= MUHLE_GO_BTIME;
+            parameters.btime = *btime;
+        }
+
+        if (winc) {
+            parameters.flags |= MUHLE_GO_WINC;
+            parameters.winc = *winc;
+        }
+
+        if (binc) {
+            parameters.flags |= MUHLE_GO_BINC;
+            parameters.binc = *binc;
+        }
+
+        go(position, ponder_moves, parameters);
+    }
+
+    void PluginEngine::start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) {
+        MuhleGo parameters {};
+        parameters.flags |= MUHLE_GO_INFINITE;
+
+        go(position, moves, parameters);
+    }
+
+    void PluginEngine::ponder_hit() {
+        m_plugin->ponder_hit(m_instance);
+
+        m_go_time = std::chrono::steady_clock::now();
+    }
+
+    void PluginEngine::stop_thinking() {
+        // The engine still replies with a best move, which is now stale
+        if (m_thinking) {
+            m_thinking = false;
+            m_stale_best_moves++;
+        }
+
+        m_plugin->stop(m_instance);
+    }
+
+    std::optional<std::string> PluginEngine::done_thinking() {
+        MUHLE_PROFILE_SCOPE("done_thinking");
+
+        std::deque<Event> events;
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            events.swap(m_events);
+        }
+
+        std::optional<std::string> best_move;
+
+        while (!events.empty() && !best_move) {
+            const Event event {std::move(events.front())};
+            events.pop_front();
+
+            switch (event.index()) {
+                case 0: {
+                    // Everything before a stale best move belongs to the stopped search
+                    if (m_stale_best_moves > 0) {
+                        break;
+                    }
+
+                    const auto& info {std::get<0>(event)};
+
+                    if (info.pv && info.pv->size() > 1) {
+                        m_expected_reply = (*info.pv)[1];
+                    }
+
+                    if (m_info_callback) {
+                        m_info_callback(info);
+                    }
+
+                    break;
+                }
+                case 1: {
+                    if (m_stale_best_moves > 0) {
+                        m_stale_best_moves--;
+                        break;
+                    }
+
+                    m_thinking = false;
+
+                    const auto& result {std::get<1>(event)};
+
+                    best_move = result.move;
+                    m_ponder_move = result.ponder ? result.ponder : m_expected_reply;
+                    m_best_move_time = result.time;
+
+                    break;
+                }
+            }
+        }
+
+        // Whatever came after the best move is kept for the next call
+        if (!events.empty()) {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_events.insert(m_events.begin(), std::make_move_iterator(events.begin()), std::make_move_iterator(events.end()));
+        }
+
+        return best_move;
+    }
+
+    void PluginEngine::uninitialize() {
+        m_name.clear();
+
+        if (m_instance == nullptr) {
+            return;
+        }
+
+        m_plugin->stop(m_instance);
+        m_plugin->destroy(m_instance);
+        m_instance = nullptr;
+
+        m_thinking = false;
+        m_stale_best_moves = 0;
+        m_events.clear();
+    }
+
+    bool PluginEngine::alive() {
+        return m_instance != nullptr;
+    }
+
+    void PluginEngine::interrupt() {
+        // Nothing ever blocks
+    }
+
+    void PluginEngine::request_stop() {
+        m_plugin->stop(m_instance);
+    }
+
+    void PluginEngine::set_log_output(bool) {
+        // There is no text to log
+    }
+
+    bool PluginEngine::is_plugin(const std::string& file_path) {
+        auto extension {std::filesystem::path(file_path).extension().string()};
+
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+
+        return extension == ".so" || extension == ".dll" || extension == ".dylib";
+    }
+
+    void PluginEngine::go(const std::optional<std::string>& position, const std::vector<std::string>& moves, MuhleGo& parameters) {
+        std::vector<const char*> move_strings;
+
+        for (const auto& move : moves) {
+            move_strings.push_back(move.c_str());
+        }
+
+        parameters.position = position ? position->c_str() : nullptr;
+        parameters.moves_size = static_cast<unsigned int>(move_strings.size());
+        parameters.moves = move_strings.data();
+
+        if (m_plugin->go(m_instance, &parameters) != 0) {
+            throw EngineError("Engine refused to start thinking");
+        }
+
+        m_thinking = true;
+        m_ponder_move.reset();
+    }
+
+    void PluginEngine::info_callback(void* user_data, const MuhleInfo* info) {
+        auto engine {static_cast<PluginEngine*>(user_data)};
+
+        Info result;
+
+        if (info->flags & MUHLE_INFO_DEPTH) {
+            result.depth = info->depth;
+        }
+
+        if (info->flags & MUHLE_INFO_TIME) {
+            result.time = info->time;
+        }
+
+        if (info->flags & MUHLE_INFO_NODES) {
+            result.nodes = info->nodes;
+        }
+
+        if (info->flags & MUHLE_INFO_MULTIPV) {
+            result.multipv = info->multipv;
+        }
+
+        if (info->flags & MUHLE_INFO_SCORE_EVAL) {
+            result.score = Info::ScoreEval {info->score};
+        } else if (info->flags & MUHLE_INFO_SCORE_WIN) {
+            result.score = Info::ScoreWin {info->score};
+        }
+
+        if (info->flags & MUHLE_INFO_PV) {
+            result.pv = std::vector<std::string>(info->pv, info->pv + info->pv_size);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock {engine->m_mutex};
+            engine->m_events.push_back(std::move(result));
+        }
+
+        if (engine->m_wake_callback) {
+            engine->m_wake_callback();
+        }
+    }
+
+    void PluginEngine::best_move_callback(void* user_data, const char* best_move, const char* ponder_move) {
+        auto engine {static_cast<PluginEngine*>(user_data)};
+
+        BestMove result;
+        result.move = best_move != nullptr ? best_move : "none";
+        result.time = std::chrono::steady_clock::now();
+
+        if (ponder_move != nullptr) {
+            result.ponder = ponder_move;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock {engine->m_mutex};
+            engine->m_events.push_back(std::move(result));
+        }
+
+        if (engine->m_wake_callback) {
+            engine->m_wake_callback();
+        }
+    }
+
+    Engine::Option PluginEngine::convert_option(const MuhleOption& option) {
+        Option result;
+        result.name = option.name != nullptr ? option.name : "";
+
+        const std::string type {option.type != nullptr ? option.type : ""};
+        const std::string default_ {option.default_ != nullptr ? option.default_ : ""};
+
+        if (type == "check") {
+            result.value = Option::Check {default_ == "true"};
+        } else if (type == "spin") {
+            int value {};
+
+            try {
+                value = std::stoi(default_);
+            } catch (...) {
+                value = option.min;
+            }
+
+            result.value = Option::Spin {value, option.min, option.max};
+        } else if (type == "combo") {
+            result.value = Option::Combo {default_, std::vector<std::string>(option.vars, option.vars + option.vars_size)};
+        } else if (type == "button") {
+            result.value = Option::Button {};
+        } else if (type == "string") {
+            result.value = Option::String {default_};
+        } else {
+            throw EngineError("Engine plugin has an invalid option " + result.name);
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <variant>
+#include <deque>
+#include <mutex>
+#include <chrono>
+
+#include "engine.hpp"
+#include "engine_plugin.h"
+
+namespace engine {
+    // Engine loaded from a shared library, talking through the C interface in engine_plugin.h
+    class PluginEngine : public Engine {
+    public:
+        PluginEngine() = default;
+        ~PluginEngine() override;
+
+        PluginEngine(const PluginEngine&) = delete;
+        PluginEngine& operator=(const PluginEngine&) = delete;
+        PluginEngine(PluginEngine&&) = delete;
+        PluginEngine& operator=(PluginEngine&&) = delete;
+
+        // The capabilities are ignored, as the library provides them for free
+        void initialize(const std::string& file_path, const std::optional<Capabilities>& capabilities) override;
+        void set_debug(bool active) override;
+        void synchronize() override;
+        void set_option(const std::string& name, const std::optional<std::string>& value) override;
+        void new_game() override;
+        void start_thinking(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc,
+            std::optional<unsigned int> depth,
+            std::optional<unsigned int> movetime
+        ) override;
+        void start_pondering(
+            const std::optional<std::string>& position,
+            const std::vector<std::string>& moves,
+            const std::string& ponder_move,
+            std::optional<unsigned int> wtime,
+            std::optional<unsigned int> btime,
+            std::optional<unsigned int> winc,
+            std::optional<unsigned int> binc
+        ) override;
+        void start_analysis(const std::optional<std::string>& position, const std::vector<std::string>& moves) override;
+        void ponder_hit() override;
+        void stop_thinking() override;
+        std::optional<std::string> done_thinking() override;
+        void uninitialize() override;
+        bool alive() override;
+        void interrupt() override;
+        void request_stop() override;
+        void set_log_output(bool enable) override;
+
+        // Shared libraries are loaded as plugins, anything else is started as a process
+        static bool is_plugin(const std::string& file_path);
+    private:
+        struct BestMove {
+            std::string move;
+            std::optional<std::string> ponder;
+            std::chrono::steady_clock::time_point time;
+        };
+
+        using Event = std::variant<Info, BestMove>;
+
+        void go(const std::optional<std::string>& position, const std::vector<std::string>& moves, MuhleGo& go);
+
+        static void info_callback(void* user_data, const MuhleInfo* info);
+        static void best_move_callback(void* user_data, const char* best_move, const char* ponder_move);
+        static Option convert_option(const MuhleOption& option);
+
+        void* m_library {nullptr};
+        const MuhleEnginePlugin* m_plugin {nullptr};
+        void* m_instance {nullptr};
+
+        // Filled by the plugin threads
+        std::mutex m_mutex;
+        std::deque<Event> m_events;
+
+        bool m_thinking {false};
+        unsigned int m_stale_best_moves {0};
+        std::optional<std::string> m_expected_reply;
+    };
+}
@@ -0,0 +1,462 @@
+#include "position_index.hpp"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <functional>
+#include <utility>
+#include <cstring>
+#include <cstdlib>
+
+#include "record.hpp"
+
+namespace position_index {
+    static constexpr char MAGIC[8] {'M', 'U', 'H', 'L', 'E', 'P', 'O', 'S'};
+    static constexpr std::uint32_t VERSION {1};
+
+    // Magic, version, padding, number of games, number of entries; the entries stay aligned
+    static constexpr std::size_t HEADER_SIZE {8 + 4 + 4 + 8 + 8};
+
+    // Entries sorted in memory at once while building, 64 MiB; the rest is merged from disk
+    static constexpr std::size_t RUN_SIZE {1u << 22};
+    static constexpr std::size_t MERGE_BUFFER_SIZE {1u << 16};  // Entries read and written at once while merging
+
+    // Coordinates of the nodes relative to the center of the board
+    static constexpr int COORDINATES[24][2] {
+        { -3, -3 }, { 0, -3 }, { 3, -3 },
+        { -2, -2 }, { 0, -2 }, { 2, -2 },
+        { -1, -1 }, { 0, -1 }, { 1, -1 },
+        { -3, 0 }, { -2, 0 }, { -1, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 },
+        { -1, 1 }, { 0, 1 }, { 1, 1 },
+        { -2, 2 }, { 0, 2 }, { 2, 2 },
+        { -3, 3 }, { 0, 3 }, { 3, 3 }
+    };
+
+    using Permutation = std::array<int, 24>;
+
+    struct Keys {
+        std::array<std::array<std::uint64_t, 24>, 2> nodes {};
+        std::uint64_t player_black {};
+        std::array<std::uint64_t, board::TWELVE> plies {};  // Only during the placing phase
+        std::array<Permutation, 16> symmetries {};
+    };
+
+    static std::uint64_t split_mix(std::uint64_t& state) {
+        std::uint64_t z {state += 0x9E3779B97F4A7C15ull};
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+        return z ^ (z >> 31);
+    }
+
+    static int node_at(int x, int y) {
+        for (int i {0}; i < 24; i++) {
+            if (COORDINATES[i][0] == x && COORDINATES[i][1] == y) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    // Four rotations, each mirrored or not, each with the inner and outer squares swapped or not
+    static std::array<Permutation, 16> generate_symmetries() {
+        std::array<Permutation, 16> symmetries {};
+
+        for (int s {0}; s < 16; s++) {
+            for (int i {0}; i < 24; i++) {
+                int x {COORDINATES[i][0]};
+                int y {COORDINATES[i][1]};
+
+                if (s & 8) {
+                    const int square {std::max(std::abs(x), std::abs(y))};
+
+                    if (square != 2) {
+                        x = x / square * (4 - square);
+                        y = y / square * (4 - square);
+                    }
+                }
+
+                if (s & 4) {
+                    x = -x;
+                }
+
+                for (int r {0}; r < (s & 3); r++) {
+                    const int t {x};
+                    x = -y;
+                    y = t;
+                }
+
+                symmetries[static_cast<std::size_t>(s)][static_cast<std::size_t>(i)] = node_at(x, y);
+            }
+        }
+
+        return symmetries;
+    }
+
+    static const Keys& keys() {
+        static const Keys keys {[]() {
+            Keys keys;
+            std::uint64_t state {0x4D75686C65ull};
+
+            for (auto& player : keys.nodes) {
+                for (auto& node : player) {
+                    node = split_mix(state);
+                }
+            }
+
+            keys.player_black = split_mix(state);
+
+            for (auto& ply : keys.plies) {
+                ply = split_mix(state);
+            }
+
+            keys.symmetries = generate_symmetries();
+
+            return keys;
+        }()};
+
+        return keys;
+    }
+
+    std::uint64_t hash(const board::Position& position, int p) {
+        const Keys& k {keys()};
+
+        std::uint64_t extra {0};
+
+        if (position.player == board::Player::Black) {
+            extra ^= k.player_black;
+        }
+
+        if (position.plies >= 0 && position.plies < p) {
+            extra ^= k.plies[static_cast<std::size_t>(position.plies)];
+        }
+
+        std::uint64_t minimum {~0ull};
+
+        for (const Permutation& symmetry : k.symmetries) {
+            std::uint64_t value {extra};
+
+            for (std::size_t i {0}; i < 24; i++) {
+                if (position.board[i] != board::Node::None) {
+                    const auto player {static_cast<std::size_t>(position.board[i]) - 1};
+                    value ^= k.nodes[player][static_cast<std::size_t>(symmetry[i])];
+                }
+            }
+
+            minimum = std::min(minimum, value);
+        }
+
+        return minimum;
+    }
+
+    void PositionIndex::open(const std::string& file_path) {
+        close();
+
+        try {
+            m_file = boost::interprocess::file_mapping(file_path.c_str(), boost::interprocess::read_only);
+            m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_only);
+        } catch (const boost::interprocess::interprocess_exception& e) {
+            throw PositionIndexError("Could not map index file `" + file_path + "`: " + e.what());
+        }
+
+        const auto data {static_cast<const unsigned char*>(m_region.get_address())};
+        const auto size {m_region.get_size()};
+
+        if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+            close();
+            throw PositionIndexError("Invalid index file `" + file_path + "`");
+        }
+
+        std::uint32_t version {};
+        std::uint64_t games {};
+        std::uint64_t entries {};
+        std::memcpy(&version, data + 8, sizeof(version));
+        std::memcpy(&games, data + 16, sizeof(games));
+        std::memcpy(&entries, data + 24, sizeof(entries));
+
+        if (version != VERSION) {
+            close();
+            throw PositionIndexError("Unsupported index file version `" + file_path + "`");
+        }
+
+        if (entries != (size - HEADER_SIZE) / sizeof(Entry)) {
+            close();
+            throw PositionIndexError("Truncated index file `" + file_path + "`");
+        }
+
+        m_entries = reinterpret_cast<const Entry*>(data + HEADER_SIZE);
+        m_entries_size = static_cast<std::size_t>(entries);
+        m_games = static_cast<std::size_t>(games);
+    }
+
+    void PositionIndex::close() {
+        m_region = boost::interprocess::mapped_region();
+        m_file = boost::interprocess::file_mapping();
+        m_entries = nullptr;
+        m_entries_size = 0;
+        m_games = 0;
+    }
+
+    std::vector<std::size_t> PositionIndex::find(const board::Position& position, int p) const {
+        return find(hash(position, p));
+    }
+
+    std::vector<std::size_t> PositionIndex::find(std::uint64_t hash) const {
+        const Entry* begin {m_entries};
+        const Entry* end {m_entries + m_entries_size};
+
+        const auto range {std::equal_range(begin, end, Entry {hash, 0}, [](const Entry& lhs, const Entry& rhs) {
+            return lhs.hash < rhs.hash;
+        })};
+
+        std::vector<std::size_t> games;
+        games.reserve(static_cast<std::size_t>(range.second - range.first));
+
+        for (auto iter {range.first}; iter != range.second; iter++) {
+            games.push_back(static_cast<std::size_t>(iter->game));
+        }
+
+        return games;
+    }
+
+    // Sort key of the entries while building; the same layout as the entries in the file
+    struct BuildEntry {
+        std::uint64_t hash;
+        std::uint64_t game;
+
+        bool operator<(const BuildEntry& other) const {
+            return hash < other.hash || (hash == other.hash && game < other.game);
+        }
+
+        bool operator==(const BuildEntry& other) const {
+            return hash == other.hash && game == other.game;
+        }
+    };
+
+    // Sorted runs that didn't fit in memory together; the files are removed when done
+    class Runs {
+    public:
+        explicit Runs(const std::string& file_path)
+            : m_file_path(file_path) {}
+
+        ~Runs() {
+            for (std::size_t i {0}; i < m_sizes.size(); i++) {
+                std::error_code ec;
+                std::filesystem::remove(run_file_path(i), ec);
+            }
+        }
+
+        Runs(const Runs&) = delete;
+        Runs& operator=(const Runs&) = delete;
+        Runs(Runs&&) = delete;
+        Runs& operator=(Runs&&) = delete;
+
+        void write(std::vector<BuildEntry>& entries) {
+            std::sort(entries.begin(), entries.end());
+
+            const std::string file_path {run_file_path(m_sizes.size())};
+            std::ofstream stream {file_path, std::ios::binary | std::ios::trunc};
+
+            m_sizes.push_back(entries.size());
+
+            stream.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(BuildEntry)));
+
+            if (!stream) {
+                throw PositionIndexError("Could not write temporary file `" + file_path + "`");
+            }
+
+            entries.clear();
+        }
+
+        // Merges the runs in order, passing on every entry
+        template<typename F>
+        void merge(F&& output) const {
+            struct Reader {
+                std::ifstream stream;
+                std::vector<BuildEntry> buffer;
+                std::size_t index {0};
+                std::size_t remaining {0};
+            };
+
+            std::vector<Reader> readers (m_sizes.size());
+
+            const auto refill {[](Reader& reader) {
+                const std::size_t size {std::min(reader.remaining, MERGE_BUFFER_SIZE)};
+
+                reader.buffer.resize(size);
+                reader.stream.read(reinterpret_cast<char*>(reader.buffer.data()), static_cast<std::streamsize>(size * sizeof(BuildEntry)));
+
+                if (!reader.stream) {
+                    throw PositionIndexError("Could not read temporary file");
+                }
+
+                reader.index = 0;
+                reader.remaining -= size;
+            }};
+
+            using Head = std::pair<BuildEntry, std::size_t>;
+            std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+
+            for (std::size_t i {0}; i < readers.size(); i++) {
+                readers[i].stream.open(run_file_path(i), std::ios::binary);
+                readers[i].remaining = m_sizes[i];
+
+                if (readers[i].remaining > 0) {
+                    refill(readers[i]);
+                    heads.push({readers[i].buffer[0], i});
+                }
+            }
+
+            while (!heads.empty()) {
+                const auto [entry, i] {heads.top()};
+                heads.pop();
+
+                output(entry);
+
+                Reader& reader {readers[i]};
+
+                if (++reader.index == reader.buffer.size()) {
+                    if (reader.remaining == 0) {
+                        continue;
+                    }
+
+                    refill(reader);
+                }
+
+                heads.push({reader.buffer[reader.index], i});
+            }
+        }
+
+        std::size_t size() const { return m_sizes.size(); }
+
+        std::uint64_t entries() const {
+            std::uint64_t result {0};
+
+            for (const std::size_t size : m_sizes) {
+                result += size;
+            }
+
+            return result;
+        }
+    private:
+        std::string run_file_path(std::size_t index) const {
+            return m_file_path + ".run" + std::to_string(index);
+        }
+
+        std::string m_file_path;
+        std::vector<std::size_t> m_sizes;
+    };
+
+    static void write_header(std::ofstream& stream, std::uint64_t games, std::uint64_t count) {
+        const std::uint32_t padding {0};
+
+        stream.write(MAGIC, sizeof(MAGIC));
+        stream.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+        stream.write(reinterpret_cast<const char*>(&padding), sizeof(padding));
+        stream.write(reinterpret_cast<const char*>(&games), sizeof(games));
+        stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+
+    void build(const std::string& record_file_path, const std::string& index_file_path) {
+        record::RecordReader reader;
+
+        try {
+            reader.open(record_file_path);
+        } catch (const record::RecordError& e) {
+            throw PositionIndexError(e.what());
+        }
+
+        const std::string temporary_file_path {index_file_path + ".tmp"};
+
+        // Large archives don't fit in memory; sorted runs are written out and merged at the end
+        Runs runs {temporary_file_path};
+        std::vector<BuildEntry> entries;
+        std::vector<board::Move> moves;
+
+        for (std::size_t i {0}; i < reader.size(); i++) {
+            record::GameHeader header;
+            moves.clear();
+
+            try {
+                header = reader.get_header(i);
+                reader.get_moves(i, moves);
+            } catch (const record::RecordError&) {
+                continue;  // Skip broken games
+            }
+
+            const int p {header.variant == record::Variant::TwelveMensMorris ? board::TWELVE : board::NINE};
+            const auto first {entries.size()};
+            board::Position position {header.setup};
+
+            entries.push_back({hash(position, p), i});
+
+            for (const board::Move& move : moves) {
+                const auto legal_moves {board::Board::generate_moves(position, p)};
+
+                if (std::find(legal_moves.cbegin(), legal_moves.cend(), move) == legal_moves.cend()) {
+                    break;
+                }
+
+                board::Board::make_move(position, move);
+                entries.push_back({hash(position, p), i});
+            }
+
+            // A game is listed only once for a position, even if it repeated it
+            std::sort(entries.begin() + static_cast<std::ptrdiff_t>(first), entries.end());
+            entries.erase(std::unique(entries.begin() + static_cast<std::ptrdiff_t>(first), entries.end()), entries.end());
+
+            // A game's entries always end up in the same run, so the runs never share an entry
+            if (entries.size() >= RUN_SIZE) {
+                runs.write(entries);
+            }
+        }
+
+        {
+            std::ofstream stream {temporary_file_path, std::ios::binary | std::ios::trunc};
+            const auto games {static_cast<std::uint64_t>(reader.size())};
+
+            if (runs.size() == 0) {
+                std::sort(entries.begin(), entries.end());
+
+                write_header(stream, games, static_cast<std::uint64_t>(entries.size()));
+                stream.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(BuildEntry)));
+            } else {
+                if (!entries.empty()) {
+                    runs.write(entries);
+                }
+
+                entries.shrink_to_fit();
+
+                write_header(stream, games, runs.entries());
+
+                std::vector<BuildEntry> buffer;
+                buffer.reserve(MERGE_BUFFER_SIZE);
+
+                runs.merge([&](const BuildEntry& entry) {
+                    buffer.push_back(entry);
+
+                    if (buffer.size() == MERGE_BUFFER_SIZE) {
+                        stream.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(BuildEntry)));
+                        buffer.clear();
+                    }
+                });
+
+                stream.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(BuildEntry)));
+            }
+
+            if (!stream) {
+                throw PositionIndexError("Could not write index file `" + temporary_file_path + "`");
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temporary_file_path, index_file_path, ec);
+
+        if (ec) {
+            throw PositionIndexError("Could not write index file `" + index_file_path + "`: " + ec.message());
+        }
+    }
+}
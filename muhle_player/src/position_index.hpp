@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "board.hpp"
+
+namespace position_index {
+    // Zobrist hash of the position, the same for all its symmetries; p is the number of plies of the placing phase
+    std::uint64_t hash(const board::Position& position, int p);
+
+    // Sorted table mapping position hashes to the games of a record file that reached them
+    class PositionIndex {
+    public:
+        void open(const std::string& file_path);
+        void close();
+
+        // Indices of the games, in ascending order; hash collisions are not filtered out
+        std::vector<std::size_t> find(const board::Position& position, int p) const;
+        std::vector<std::size_t> find(std::uint64_t hash) const;
+
+        std::size_t size() const { return m_entries_size; }
+        std::size_t get_games() const { return m_games; }
+    private:
+        struct Entry {
+            std::uint64_t hash;
+            std::uint64_t game;
+        };
+
+        boost::interprocess::file_mapping m_file;
+        boost::interprocess::mapped_region m_region;
+        const Entry* m_entries {nullptr};
+        std::size_t m_entries_size {};
+        std::size_t m_games {};  // Of the record file, when the index was built
+    };
+
+    // Replays every game of the record file; games are indexed up to the first illegal move
+    void build(const std::string& record_file_path, const std::string& index_file_path);
+
+    struct PositionIndexError : std::runtime_error {
+        explicit PositionIndexError(const char* message)
+            : std::runtime_error(message) {}
+        explicit PositionIndexError(const std::string& message)
+            : std::runtime_error(message) {}
+    };
+}
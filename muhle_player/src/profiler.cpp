@@ -0,0 +1,132 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace profiler {
+    // Other threads never read the state of the profiler, so it needs no synchronization
+    static thread_local bool t_frame_thread {false};
+
+    Profiler& Profiler::get() {
+        static Profiler profiler;
+
+        return profiler;
+    }
+
+    void Profiler::begin_frame() {
+        t_frame_thread = true;
+        m_in_frame = true;
+        m_frame.clear();
+        m_open.clear();
+        m_frame_begin = Clock::now();
+    }
+
+    void Profiler::end_frame() {
+        if (!m_in_frame) {
+            return;
+        }
+
+        const float frame_time {since_frame_begin()};
+
+        // Scopes still open are cut at the end of the frame
+        for (const std::size_t index : m_open) {
+            m_frame[index].end = frame_time;
+        }
+
+        m_in_frame = false;
+        m_open.clear();
+
+        for (Section& section : m_sections) {
+            section.current = 0.0f;
+        }
+
+        // Sections can be entered more than once per frame
+        for (const Record& record : m_frame) {
+            get_section(record.name).current += record.end - record.begin;
+        }
+
+        for (Section& section : m_sections) {
+            section.times[m_frames % HISTORY] = section.current;
+        }
+
+        get_section("frame").times[m_frames % HISTORY] = frame_time;
+
+        m_frames++;
+        m_last_frame_time = frame_time;
+        std::swap(m_frame, m_last_frame);
+    }
+
+    bool Profiler::begin_scope(const char* name) {
+        if (!t_frame_thread || !m_in_frame) {
+            return false;
+        }
+
+        Record record;
+        record.name = name;
+        record.begin = since_frame_begin();
+        record.depth = static_cast<int>(m_open.size());
+
+        m_open.push_back(m_frame.size());
+        m_frame.push_back(record);
+
+        return true;
+    }
+
+    void Profiler::end_scope() {
+        if (m_open.empty()) {
+            return;  // Cut by the end of the frame
+        }
+
+        m_frame[m_open.back()].end = since_frame_begin();
+        m_open.pop_back();
+    }
+
+    std::vector<Profiler::Statistics> Profiler::get_statistics() const {
+        std::vector<Statistics> result;
+        const std::size_t frames {std::min(m_frames, HISTORY)};
+
+        if (frames == 0) {
+            return result;
+        }
+
+        std::array<float, HISTORY> times {};
+
+        for (const Section& section : m_sections) {
+            std::copy_n(section.times.cbegin(), frames, times.begin());
+            std::sort(times.begin(), times.begin() + static_cast<std::ptrdiff_t>(frames));
+
+            float sum {0.0f};
+
+            for (std::size_t i {0}; i < frames; i++) {
+                sum += times[i];
+            }
+
+            const auto p99 {(frames * 99 + 99) / 100 - 1};
+
+            result.push_back({section.name, times[0], sum / static_cast<float>(frames), times[p99]});
+        }
+
+        return result;
+    }
+
+    float Profiler::since_frame_begin() const {
+        return std::chrono::duration<float, std::milli>(Clock::now() - m_frame_begin).count();
+    }
+
+    Profiler::Section& Profiler::get_section(const char* name) {
+        // Identical literals are not guaranteed to share the same address
+        const auto iter {std::find_if(m_sections.begin(), m_sections.end(), [name](const Section& section) {
+            return section.name == name || std::strcmp(section.name, name) == 0;
+        })};
+
+        if (iter != m_sections.end()) {
+            return *iter;
+        }
+
+        Section section;
+        section.name = name;
+
+        // New sections have not taken any time in the previous frames
+        return m_sections.emplace_back(section);
+    }
+}
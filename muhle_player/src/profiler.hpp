@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace profiler {
+    // Times nested sections of a frame; scopes outside of a frame, or on other threads, are ignored
+    class Profiler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr std::size_t HISTORY {240};  // Frames
+
+        struct Record {
+            const char* name {};
+            float begin {};  // Milliseconds since the beginning of the frame
+            float end {};
+            int depth {};
+        };
+
+        struct Statistics {
+            const char* name {};
+            float min {};
+            float avg {};
+            float p99 {};
+        };
+
+        static Profiler& get();
+
+        void begin_frame();
+        void end_frame();
+
+        // The name must be a string literal, or must otherwise outlive the profiler
+        bool begin_scope(const char* name);
+        void end_scope();
+
+        const std::vector<Record>& get_last_frame() const { return m_last_frame; }
+        float get_last_frame_time() const { return m_last_frame_time; }
+
+        // Total time per frame of every section, over the last frames
+        std::vector<Statistics> get_statistics() const;
+    private:
+        struct Section {
+            const char* name {};
+            std::array<float, HISTORY> times {};
+            float current {};
+        };
+
+        float since_frame_begin() const;
+        Section& get_section(const char* name);
+
+        bool m_in_frame {false};  // Only touched by the frame thread
+        Clock::time_point m_frame_begin;
+        std::vector<Record> m_frame;
+        std::vector<std::size_t> m_open;  // Indices of the records not yet ended
+        std::vector<Record> m_last_frame;
+        float m_last_frame_time {};
+        std::vector<Section> m_sections;
+        std::size_t m_frames {0};
+    };
+
+    class Scope {
+    public:
+        explicit Scope(const char* name)
+            : m_active(Profiler::get().begin_scope(name)) {}
+
+        ~Scope() {
+            if (m_active) {
+                Profiler::get().end_scope();
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+        Scope& operator=(Scope&&) = delete;
+    private:
+        bool m_active {false};
+    };
+}
+
+#ifdef MUHLE_PROFILER
+    #define MUHLE_PROFILE_CONCATENATE_(a, b) a##b
+    #define MUHLE_PROFILE_CONCATENATE(a, b) MUHLE_PROFILE_CONCATENATE_(a, b)
+    #define MUHLE_PROFILE_SCOPE(name) profiler::Scope MUHLE_PROFILE_CONCATENATE(profile_scope_, __LINE__) {name}
+    #define MUHLE_PROFILE_BEGIN_FRAME() profiler::Profiler::get().begin_frame()
+    #define MUHLE_PROFILE_END_FRAME() profiler::Profiler::get().end_frame()
+#else
+    #define MUHLE_PROFILE_SCOPE(name)
+    #define MUHLE_PROFILE_BEGIN_FRAME()
+    #define MUHLE_PROFILE_END_FRAME()
+#endif
@@ -0,0 +1,495 @@
+#include "record.hpp"
+
+#include <filesystem>
+#include <limits>
+#include <cstring>
+
+namespace record {
+    static constexpr char MAGIC[8] {'M', 'U', 'H', 'L', 'E', 'R', 'E', 'C'};
+    static constexpr char INDEX_MAGIC[8] {'M', 'U', 'H', 'L', 'E', 'I', 'D', 'X'};
+    static constexpr std::uint32_t VERSION {2};
+    static constexpr std::uint32_t VERSION_NO_TERMINATION {1};
+    static constexpr std::size_t HEADER_SIZE {sizeof(MAGIC) + sizeof(VERSION)};
+    static constexpr std::size_t INDEX_TAIL_SIZE {sizeof(std::uint64_t) + sizeof(INDEX_MAGIC)};
+
+    // Board, player, plies, variant, result, number of moves; the termination shares the byte of the result
+    static constexpr std::size_t GAME_HEADER_SIZE {8 + 1 + 2 + 1 + 1 + 2};
+
+    // Place moves have the high bit clear; the rest store the indices in base 24
+    static constexpr unsigned int TWO_BYTES {0x8000};
+    static constexpr unsigned int MOVE_CAPTURE {0x4000};
+    static constexpr unsigned int MOVE {0x2000};
+
+    template<typename T>
+    static void put_value(std::vector<unsigned char>& buffer, T value) {
+        const auto size {buffer.size()};
+        buffer.resize(size + sizeof(value));
+        std::memcpy(buffer.data() + size, &value, sizeof(value));
+    }
+
+    template<typename T>
+    static T get_value(const unsigned char*& data, const unsigned char* end) {
+        if (static_cast<std::size_t>(end - data) < sizeof(T)) {
+            throw RecordError("Unexpected end of game");
+        }
+
+        T value {};
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+
+        return value;
+    }
+
+    template<typename T>
+    static T read_value(std::istream& stream) {
+        T value {};
+        stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+
+        if (!stream) {
+            throw RecordError("Unexpected end of file");
+        }
+
+        return value;
+    }
+
+    static unsigned int check_index(int index) {
+        if (index < 0 || index >= 24) {
+            throw RecordError("Invalid move index");
+        }
+
+        return static_cast<unsigned int>(index);
+    }
+
+    static void put_move(std::vector<unsigned char>& buffer, const board::Move& move) {
+        unsigned int value {};
+
+        switch (move.type) {
+            case board::MoveType::Place:
+                buffer.push_back(static_cast<unsigned char>(check_index(move.place.place_index)));
+                return;
+            case board::MoveType::PlaceCapture:
+                value = TWO_BYTES | (check_index(move.place_capture.place_index) * 24 + check_index(move.place_capture.capture_index));
+                break;
+            case board::MoveType::Move:
+                value = TWO_BYTES | MOVE | (check_index(move.move.source_index) * 24 + check_index(move.move.destination_index));
+                break;
+            case board::MoveType::MoveCapture:
+                value = TWO_BYTES | MOVE_CAPTURE | (
+                    (check_index(move.move_capture.source_index) * 24 + check_index(move.move_capture.destination_index)) * 24 +
+                    check_index(move.move_capture.capture_index)
+                );
+                break;
+        }
+
+        buffer.push_back(static_cast<unsigned char>(value >> 8));
+        buffer.push_back(static_cast<unsigned char>(value & 0xFF));
+    }
+
+    static board::Move get_move(const unsigned char*& data, const unsigned char* end) {
+        if (data == end) {
+            throw RecordError("Unexpected end of game");
+        }
+
+        if ((*data & 0x80) == 0) {
+            const int index {*data++};
+
+            if (index >= 24) {
+                throw RecordError("Invalid move");
+            }
+
+            return board::Move::create_place(index);
+        }
+
+        if (end - data < 2) {
+            throw RecordError("Unexpected end of game");
+        }
+
+        const unsigned int value {static_cast<unsigned int>(data[0]) << 8 | static_cast<unsigned int>(data[1])};
+        data += 2;
+
+        if (value & MOVE_CAPTURE) {
+            const unsigned int indices {value & (MOVE_CAPTURE - 1)};
+
+            if (indices >= 24 * 24 * 24) {
+                throw RecordError("Invalid move");
+            }
+
+            return board::Move::create_move_capture(
+                static_cast<int>(indices / 24 / 24),
+                static_cast<int>(indices / 24 % 24),
+                static_cast<int>(indices % 24)
+            );
+        }
+
+        const unsigned int indices {value & (MOVE - 1)};
+
+        if (indices >= 24 * 24) {
+            throw RecordError("Invalid move");
+        }
+
+        if (value & MOVE) {
+            return board::Move::create_move(static_cast<int>(indices / 24), static_cast<int>(indices % 24));
+        } else {
+            return board::Move::create_place_capture(static_cast<int>(indices / 24), static_cast<int>(indices % 24));
+        }
+    }
+
+    static void put_game(std::vector<unsigned char>& buffer, const GameHeader& header, const std::vector<board::Move>& moves) {
+        if (moves.size() > std::numeric_limits<std::uint16_t>::max()) {
+            throw RecordError("Too many moves");
+        }
+
+        if (header.setup.plies < 0 || header.setup.plies > std::numeric_limits<std::uint16_t>::max()) {
+            throw RecordError("Invalid setup position");
+        }
+
+        // Two bits per node
+        std::uint64_t nodes {0};
+
+        for (std::size_t i {0}; i < header.setup.board.size(); i++) {
+            nodes |= static_cast<std::uint64_t>(header.setup.board[i]) << (i * 2);
+        }
+
+        put_value(buffer, std::uint32_t());  // Size, filled in at the end
+        put_value(buffer, nodes);
+        put_value(buffer, static_cast<std::uint8_t>(header.setup.player));
+        put_value(buffer, static_cast<std::uint16_t>(header.setup.plies));
+        put_value(buffer, static_cast<std::uint8_t>(header.variant));
+        put_value(buffer, static_cast<std::uint8_t>(static_cast<unsigned int>(header.result) | static_cast<unsigned int>(header.termination) << 4));
+        put_value(buffer, static_cast<std::uint16_t>(moves.size()));
+
+        for (const board::Move& move : moves) {
+            put_move(buffer, move);
+        }
+
+        const auto size {static_cast<std::uint32_t>(buffer.size() - sizeof(std::uint32_t))};
+        std::memcpy(buffer.data(), &size, sizeof(size));
+    }
+
+    static GameHeader get_game_header(const unsigned char*& data, const unsigned char* end) {
+        GameHeader header;
+
+        const auto nodes {get_value<std::uint64_t>(data, end)};
+
+        for (std::size_t i {0}; i < header.setup.board.size(); i++) {
+            const auto node {static_cast<unsigned int>(nodes >> (i * 2) & 0b11)};
+
+            if (node > static_cast<unsigned int>(board::Node::Black)) {
+                throw RecordError("Invalid setup position");
+            }
+
+            header.setup.board[i] = static_cast<board::Node>(node);
+        }
+
+        switch (get_value<std::uint8_t>(data, end)) {
+            case static_cast<std::uint8_t>(board::Player::White):
+                header.setup.player = board::Player::White;
+                break;
+            case static_cast<std::uint8_t>(board::Player::Black):
+                header.setup.player = board::Player::Black;
+                break;
+            default:
+                throw RecordError("Invalid setup position");
+        }
+
+        header.setup.plies = get_value<std::uint16_t>(data, end);
+
+        const auto variant {get_value<std::uint8_t>(data, end)};
+
+        if (variant > static_cast<std::uint8_t>(Variant::TwelveMensMorris)) {
+            throw RecordError("Invalid variant");
+        }
+
+        header.variant = static_cast<Variant>(variant);
+
+        const auto result {get_value<std::uint8_t>(data, end)};
+
+        if ((result & 0x0F) > static_cast<unsigned int>(board::GameOver::Draw)) {
+            throw RecordError("Invalid result");
+        }
+
+        if (result >> 4 > static_cast<unsigned int>(Termination::Forfeit)) {
+            throw RecordError("Invalid termination");
+        }
+
+        header.result = static_cast<board::GameOver>(result & 0x0F);
+        header.termination = static_cast<Termination>(result >> 4);
+        header.moves = get_value<std::uint16_t>(data, end);
+
+        return header;
+    }
+
+    RecordWriter::~RecordWriter() {
+        try {
+            close();
+        } catch (const RecordError&) {}
+    }
+
+    void RecordWriter::open(const std::string& file_path) {
+        if (m_stream.is_open()) {
+            throw RecordError("Record file already open");
+        }
+
+        m_file_path = file_path;
+        m_offsets.clear();
+
+        std::error_code ec;
+        const auto exists {std::filesystem::exists(file_path, ec)};
+
+        if (!exists || std::filesystem::file_size(file_path, ec) == 0) {
+            std::ofstream stream {file_path, std::ios::binary | std::ios::trunc};
+            stream.write(MAGIC, sizeof(MAGIC));
+            stream.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+
+            if (!stream) {
+                throw RecordError("Could not create record file `" + file_path + "`");
+            }
+        }
+
+        m_stream.open(file_path, std::ios::binary | std::ios::in | std::ios::out);
+
+        if (!m_stream.is_open()) {
+            throw RecordError("Could not open record file `" + file_path + "`");
+        }
+
+        try {
+            recover_index();
+        } catch (const RecordError&) {
+            m_stream.close();
+            throw;
+        }
+    }
+
+    void RecordWriter::append(const GameHeader& header, const std::vector<board::Move>& moves) {
+        if (!m_stream.is_open()) {
+            throw RecordError("Record file not open");
+        }
+
+        std::vector<unsigned char> buffer;
+        put_game(buffer, header, moves);
+
+        m_stream.seekp(0, std::ios::end);
+        const auto offset {static_cast<std::uint64_t>(m_stream.tellp())};
+
+        m_stream.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+
+        if (!m_stream) {
+            throw RecordError("Could not write to record file `" + m_file_path + "`");
+        }
+
+        m_offsets.push_back(offset);
+    }
+
+    void RecordWriter::close() {
+        if (!m_stream.is_open()) {
+            return;
+        }
+
+        const auto count {static_cast<std::uint64_t>(m_offsets.size())};
+
+        m_stream.seekp(0, std::ios::end);
+        m_stream.write(reinterpret_cast<const char*>(m_offsets.data()), static_cast<std::streamsize>(m_offsets.size() * sizeof(std::uint64_t)));
+        m_stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        m_stream.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        m_stream.close();
+
+        if (!m_stream) {
+            throw RecordError("Could not write index to record file `" + m_file_path + "`");
+        }
+    }
+
+    void RecordWriter::recover_index() {
+        char magic[sizeof(MAGIC)] {};
+        m_stream.read(magic, sizeof(magic));
+
+        if (!m_stream || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw RecordError("Invalid record file `" + m_file_path + "`");
+        }
+
+        const auto version {read_value<std::uint32_t>(m_stream)};
+
+        if (version != VERSION && version != VERSION_NO_TERMINATION) {
+            throw RecordError("Unsupported record file version `" + m_file_path + "`");
+        }
+
+        m_stream.seekg(0, std::ios::end);
+        const auto size {static_cast<std::uint64_t>(m_stream.tellg())};
+        std::uint64_t end {HEADER_SIZE};
+        bool indexed {false};
+
+        // Take the index at the end, if it's there and sane
+        if (size >= HEADER_SIZE + INDEX_TAIL_SIZE) {
+            m_stream.seekg(static_cast<std::streamoff>(size - INDEX_TAIL_SIZE));
+            const auto count {read_value<std::uint64_t>(m_stream)};
+            m_stream.read(magic, sizeof(magic));
+
+            if (m_stream && std::memcmp(magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 && count <= (size - HEADER_SIZE - INDEX_TAIL_SIZE) / sizeof(std::uint64_t)) {
+                end = size - INDEX_TAIL_SIZE - count * sizeof(std::uint64_t);
+                m_offsets.resize(static_cast<std::size_t>(count));
+
+                m_stream.seekg(static_cast<std::streamoff>(end));
+                m_stream.read(reinterpret_cast<char*>(m_offsets.data()), static_cast<std::streamsize>(count * sizeof(std::uint64_t)));
+
+                indexed = static_cast<bool>(m_stream);
+            }
+        }
+
+        // Otherwise walk the games, dropping a partially written one
+        if (!indexed) {
+            m_stream.clear();
+            m_offsets.clear();
+            end = HEADER_SIZE;
+
+            while (end + sizeof(std::uint32_t) <= size) {
+                m_stream.seekg(static_cast<std::streamoff>(end));
+                const auto game_size {read_value<std::uint32_t>(m_stream)};
+
+                if (game_size < GAME_HEADER_SIZE || end + sizeof(std::uint32_t) + game_size > size) {
+                    break;
+                }
+
+                m_offsets.push_back(end);
+                end += sizeof(std::uint32_t) + game_size;
+            }
+        }
+
+        m_stream.close();
+
+        // The index is written again on close
+        std::error_code ec;
+        std::filesystem::resize_file(m_file_path, end, ec);
+
+        if (ec) {
+            throw RecordError("Could not truncate record file `" + m_file_path + "`: " + ec.message());
+        }
+
+        m_stream.open(m_file_path, std::ios::binary | std::ios::in | std::ios::out);
+
+        if (!m_stream.is_open()) {
+            throw RecordError("Could not open record file `" + m_file_path + "`");
+        }
+
+        if (version == VERSION_NO_TERMINATION) {
+            upgrade_version();
+        }
+    }
+
+    void RecordWriter::upgrade_version() {
+        // The old games are valid as they are; only the header changes
+        m_stream.seekp(sizeof(MAGIC));
+        m_stream.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+
+        if (!m_stream) {
+            throw RecordError("Could not upgrade record file `" + m_file_path + "`");
+        }
+    }
+
+    void RecordReader::open(const std::string& file_path) {
+        close();
+
+        try {
+            m_file = boost::interprocess::file_mapping(file_path.c_str(), boost::interprocess::read_only);
+            m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_only);
+        } catch (const boost::interprocess::interprocess_exception& e) {
+            throw RecordError("Could not map record file `" + file_path + "`: " + e.what());
+        }
+
+        const auto data {static_cast<const unsigned char*>(m_region.get_address())};
+        const auto size {m_region.get_size()};
+
+        if (size < HEADER_SIZE + INDEX_TAIL_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+            close();
+            throw RecordError("Invalid record file `" + file_path + "`");
+        }
+
+        std::uint32_t version {};
+        std::memcpy(&version, data + sizeof(MAGIC), sizeof(version));
+
+        if (version != VERSION && version != VERSION_NO_TERMINATION) {
+            close();
+            throw RecordError("Unsupported record file version `" + file_path + "`");
+        }
+
+        std::uint64_t count {};
+        std::memcpy(&count, data + size - INDEX_TAIL_SIZE, sizeof(count));
+
+        if (
+            std::memcmp(data + size - sizeof(INDEX_MAGIC), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            count > (size - HEADER_SIZE - INDEX_TAIL_SIZE) / sizeof(std::uint64_t)
+        ) {
+            close();
+            throw RecordError("Missing index in record file `" + file_path + "`");
+        }
+
+        m_data = data;
+        m_games = static_cast<std::size_t>(count);
+        m_index = size - INDEX_TAIL_SIZE - m_games * sizeof(std::uint64_t);
+    }
+
+    void RecordReader::close() {
+        m_region = boost::interprocess::mapped_region();
+        m_file = boost::interprocess::file_mapping();
+        m_data = nullptr;
+        m_index = 0;
+        m_games = 0;
+    }
+
+    std::uint64_t RecordReader::get_offset(std::size_t index) const {
+        if (index >= m_games) {
+            throw RecordError("Game index out of range");
+        }
+
+        std::uint64_t offset {};
+        std::memcpy(&offset, m_data + m_index + index * sizeof(std::uint64_t), sizeof(offset));
+
+        return offset;
+    }
+
+    GameHeader RecordReader::get_header(std::size_t index) const {
+        std::size_t size {};
+        const unsigned char* data {game_data(index, size)};
+
+        return get_game_header(data, data + size);
+    }
+
+    void RecordReader::get_moves(std::size_t index, std::vector<board::Move>& moves) const {
+        std::size_t size {};
+        const unsigned char* data {game_data(index, size)};
+        const unsigned char* end {data + size};
+
+        const GameHeader header {get_game_header(data, end)};
+
+        moves.reserve(moves.size() + header.moves);
+
+        for (std::size_t i {0}; i < header.moves; i++) {
+            moves.push_back(get_move(data, end));
+        }
+    }
+
+    Game RecordReader::get_game(std::size_t index) const {
+        Game game;
+        game.header = get_header(index);
+        get_moves(index, game.moves);
+
+        return game;
+    }
+
+    const unsigned char* RecordReader::game_data(std::size_t index, std::size_t& size) const {
+        const auto offset {get_offset(index)};
+
+        if (offset < HEADER_SIZE || offset + sizeof(std::uint32_t) > m_index) {
+            throw RecordError("Invalid game offset");
+        }
+
+        std::uint32_t game_size {};
+        std::memcpy(&game_size, m_data + offset, sizeof(game_size));
+
+        if (offset + sizeof(std::uint32_t) + game_size > m_index) {
+            throw RecordError("Invalid game size");
+        }
+
+        size = game_size;
+
+        return m_data + offset + sizeof(std::uint32_t);
+    }
+}
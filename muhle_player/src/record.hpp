@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "board.hpp"
+
+/*
+    Binary game record file
+
+    header: magic, version
+    games: size, setup position, variant, result and termination, number of moves, packed moves
+    index: offset of every game, number of games, magic
+
+    Place moves take one byte, everything else two. The index is rewritten at the end
+    every time the file is closed; if it is missing, it is rebuilt by walking the games.
+
+    Version 1 has no termination, which is otherwise the same as normal; such files are still
+    read, and are upgraded when appended to.
+*/
+
+namespace record {
+    enum class Variant : std::uint8_t {
+        NineMensMorris,
+        TwelveMensMorris
+    };
+
+    // How the result came about
+    enum class Termination : std::uint8_t {
+        Normal,
+        Adjudication,
+        Forfeit  // An engine crashed or broke the protocol
+    };
+
+    // Everything about a game except the moves
+    struct GameHeader {
+        board::Position setup;
+        Variant variant {Variant::NineMensMorris};
+        board::GameOver result {board::GameOver::None};
+        Termination termination {Termination::Normal};
+        std::size_t moves {};
+    };
+
+    struct Game {
+        GameHeader header;
+        std::vector<board::Move> moves;
+    };
+
+    // Appends games to a file, creating it if it doesn't exist
+    // Opening reads the index and closing writes all of it again, so keep it open for many games
+    class RecordWriter {
+    public:
+        RecordWriter() = default;
+        ~RecordWriter();
+
+        RecordWriter(const RecordWriter&) = delete;
+        RecordWriter& operator=(const RecordWriter&) = delete;
+        RecordWriter(RecordWriter&&) = delete;
+        RecordWriter& operator=(RecordWriter&&) = delete;
+
+        void open(const std::string& file_path);
+        void append(const GameHeader& header, const std::vector<board::Move>& moves);
+        void close();
+
+        bool is_open() const { return m_stream.is_open(); }
+        std::size_t size() const { return m_offsets.size(); }
+    private:
+        void recover_index();
+        void upgrade_version();
+
+        std::string m_file_path;
+        std::fstream m_stream;
+        std::vector<std::uint64_t> m_offsets;
+    };
+
+    // Reads games directly out of a memory-mapped file; the file must not be written meanwhile
+    class RecordReader {
+    public:
+        void open(const std::string& file_path);
+        void close();
+
+        std::size_t size() const { return m_games; }
+        std::uint64_t get_offset(std::size_t index) const;
+        GameHeader get_header(std::size_t index) const;
+
+        // The moves are appended to the vector, so it can be reused
+        void get_moves(std::size_t index, std::vector<board::Move>& moves) const;
+        Game get_game(std::size_t index) const;
+    private:
+        const unsigned char* game_data(std::size_t index, std::size_t& size) const;
+
+        boost::interprocess::file_mapping m_file;
+        boost::interprocess::mapped_region m_region;
+        const unsigned char* m_data {nullptr};
+        std::size_t m_index {};  // Where the offsets begin
+        std::size_t m_games {};
+    };
+
+    struct RecordError : std::runtime_error {
+        explicit RecordError(const char* message)
+            : std::runtime_error(message) {}
+        explicit RecordError(const std::string& message)
+            : std::runtime_error(message) {}
+    };
+}
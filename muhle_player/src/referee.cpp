@@ -0,0 +1,81 @@
+#include "referee.hpp"
+
+#include <iostream>
+
+namespace referee {
+    void Referee::reset() {
+        m_adjudicator.reset();
+        m_termination = record::Termination::Normal;
+        m_timeout = false;
+    }
+
+    void Referee::set_adjudication(const adjudication::Settings& settings) {
+        m_adjudicator = adjudication::Adjudicator(settings);
+    }
+
+    void Referee::update(const engine::Engine::Info& info) {
+        m_adjudicator.update(info);
+    }
+
+    bool Referee::play_engine_move(board::Board& board, const std::string& best_move) {
+        const auto player {board.get_player()};
+
+        if (best_move == "none") {
+            if (board.get_game_over() == board::GameOver::None) {
+                forfeit(board, player, "The engine calls game over, but the board doesn't agree");
+            }
+
+            return true;
+        }
+
+        try {
+            board.play_move(board::move_from_string(best_move));
+        } catch (const board::BoardError&) {
+            forfeit(board, player, "The engine played an illegal move `" + best_move + "`");
+            return true;
+        }
+
+        // A result from the rules takes precedence
+        if (board.get_game_over() == board::GameOver::None) {
+            const auto result {m_adjudicator.adjudicate(player, board.get_ply())};
+
+            if (result != board::GameOver::None) {
+                board.adjudicate(result);
+                m_termination = record::Termination::Adjudication;
+            }
+        }
+
+        return board.get_game_over() != board::GameOver::None;
+    }
+
+    void Referee::flag(board::Board& board) {
+        board.timeout(board.get_player());
+        m_timeout = true;
+    }
+
+    void Referee::forfeit(board::Board& board, board::Player player, const std::string& reason) {
+        // The result stands, whatever happens after it
+        if (board.get_game_over() != board::GameOver::None) {
+            return;
+        }
+
+        std::cerr << (player == board::Player::White ? "White" : "Black") << " forfeits: " << reason << '\n';
+
+        board.adjudicate(board::Board::winner(board::Board::opponent(player)));
+        m_termination = record::Termination::Forfeit;
+    }
+
+    record::Game Referee::make_record(const board::Board& board, const std::vector<std::string>& moves, bool twelve_mens_morris) const {
+        record::Game game;
+        game.header.setup = board.get_setup_position();
+        game.header.variant = twelve_mens_morris ? record::Variant::TwelveMensMorris : record::Variant::NineMensMorris;
+        game.header.result = board.get_game_over();
+        game.header.termination = m_termination;
+
+        for (const auto& move : moves) {
+            game.moves.push_back(board::move_from_string(move));
+        }
+
+        return game;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+#include "engine.hpp"
+#include "record.hpp"
+#include "adjudication.hpp"
+
+namespace referee {
+    // Decides how games end and records them, the same way for the GUI and the headless mode
+    class Referee {
+    public:
+        explicit Referee(const adjudication::Settings& settings = {})
+            : m_adjudicator(settings) {}
+
+        // Before every game
+        void reset();
+
+        // Takes effect from the next reset
+        void set_adjudication(const adjudication::Settings& settings);
+
+        // Feed every info message of the engine to move
+        void update(const engine::Engine::Info& info);
+
+        // Checks and plays the best move of the engine to move, which loses the game if it's wrong
+        // Late moves must be flagged instead; returns true if the game is over
+        bool play_engine_move(board::Board& board, const std::string& best_move);
+
+        // The player to move has run out of time
+        void flag(board::Board& board);
+
+        // The engine of the player crashed or broke the protocol
+        void forfeit(board::Board& board, board::Player player, const std::string& reason);
+
+        bool timed_out() const { return m_timeout; }
+        bool adjudicated() const { return m_termination == record::Termination::Adjudication; }
+        bool forfeited() const { return m_termination == record::Termination::Forfeit; }
+
+        // The game as it is saved, with the result and how it came about
+        record::Game make_record(const board::Board& board, const std::vector<std::string>& moves, bool twelve_mens_morris) const;
+    private:
+        adjudication::Adjudicator m_adjudicator;
+        record::Termination m_termination {record::Termination::Normal};
+        bool m_timeout {false};
+    };
+}
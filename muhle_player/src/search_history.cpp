@@ -0,0 +1,119 @@
+#include "search_history.hpp"
+
+#include <cassert>
+
+#include "board.hpp"
+
+namespace search_history {
+    void SearchHistory::update(const engine::Engine::Info& info) {
+        if (m_current_valid && info.depth && *info.depth != m_current.depth) {
+            commit();
+        }
+
+        m_current_valid = true;
+
+        merge(m_current, info);
+    }
+
+    void SearchHistory::commit() {
+        if (!m_current_valid) {
+            return;
+        }
+
+        if (m_size < CAPACITY) {
+            m_entries[(m_begin + m_size) % CAPACITY] = m_current;
+            m_size++;
+        } else {
+            m_entries[m_begin] = m_current;
+            m_begin = (m_begin + 1) % CAPACITY;
+        }
+
+        m_current = Entry();
+        m_current_valid = false;
+    }
+
+    void SearchHistory::clear() {
+        m_begin = 0;
+        m_size = 0;
+        m_current = Entry();
+        m_current_valid = false;
+    }
+
+    const Entry& SearchHistory::get(std::size_t index) const {
+        assert(index < m_size);
+
+        return m_entries[(m_begin + index) % CAPACITY];
+    }
+
+    void SearchHistory::merge(Entry& entry, const engine::Engine::Info& info) {
+        if (info.depth) {
+            entry.depth = *info.depth;
+        }
+
+        if (info.time) {
+            entry.time = *info.time;
+        }
+
+        if (info.nodes) {
+            entry.nodes = *info.nodes;
+        }
+
+        if (info.score) {
+            switch (info.score->index()) {
+                case 0:
+                    entry.score = std::get<0>(*info.score).value;
+                    entry.score_type = ScoreType::Eval;
+                    break;
+                case 1:
+                    entry.score = std::get<1>(*info.score).value;
+                    entry.score_type = ScoreType::Win;
+                    break;
+            }
+        }
+
+        if (info.pv) {
+            entry.pv_size = 0;
+
+            for (const auto& move : *info.pv) {
+                if (entry.pv_size == MAX_PV) {
+                    break;
+                }
+
+                try {
+                    entry.pv[entry.pv_size] = board::pack_move(board::move_from_string(move));
+                } catch (const board::BoardError&) {
+                    break;
+                }
+
+                entry.pv_size++;
+            }
+        }
+    }
+
+    std::string SearchHistory::score_to_string(const Entry& entry) {
+        switch (entry.score_type) {
+            case ScoreType::None:
+                break;
+            case ScoreType::Eval:
+                return "eval " + std::to_string(entry.score);
+            case ScoreType::Win:
+                return "win " + std::to_string(entry.score);
+        }
+
+        return {};
+    }
+
+    std::string SearchHistory::pv_to_string(const Entry& entry) {
+        std::string result;
+
+        for (std::size_t i {0}; i < entry.pv_size; i++) {
+            if (i > 0) {
+                result += ' ';
+            }
+
+            result += board::move_to_string(board::unpack_move(entry.pv[i]));
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "engine.hpp"
+
+namespace search_history {
+    inline constexpr std::size_t MAX_PV {16};
+
+    enum class ScoreType : unsigned char {
+        None,
+        Eval,
+        Win
+    };
+
+    // One completed search depth, small enough to be kept in bulk
+    struct Entry {
+        unsigned int depth {};
+        unsigned int time {};
+        unsigned int nodes {};
+        int score {};
+        ScoreType score_type {ScoreType::None};
+        unsigned char pv_size {};
+        std::array<std::uint16_t, MAX_PV> pv {};
+    };
+
+    class SearchHistory {
+    public:
+        // Merge a new info message into the current entry
+        // A change of depth commits the current entry first
+        void update(const engine::Engine::Info& info);
+
+        // Push the current entry, if any, into the history
+        void commit();
+        void clear();
+
+        const Entry& get_current() const { return m_current; }
+        std::size_t size() const { return m_size; }
+        const Entry& get(std::size_t index) const;
+
+        static void merge(Entry& entry, const engine::Engine::Info& info);
+        static std::string score_to_string(const Entry& entry);
+        static std::string pv_to_string(const Entry& entry);
+    private:
+        static constexpr std::size_t CAPACITY {256};
+
+        std::array<Entry, CAPACITY> m_entries {};
+        std::size_t m_begin {0};
+        std::size_t m_size {0};
+
+        Entry m_current;
+        bool m_current_valid {false};
+    };
+}
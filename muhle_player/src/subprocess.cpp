@@ -3,6 +3,8 @@
 #include <utility>
 #include <cassert>
 
+#include "trace.hpp"
+
 namespace subprocess {
     Subprocess::Subprocess()
         : m_out(m_context), m_in(m_context), m_process(m_context) {}
@@ -29,10 +31,17 @@ namespace subprocess {
         task_read_line();
 
         m_context_thread = std::thread([this]() {
+            trace::set_thread_name("subprocess");
+
             try {
                 m_context.run();
             } catch (...) {
-                m_exception = std::current_exception();
+                {
+                    std::lock_guard lock {m_read_mutex};
+                    m_exception = std::current_exception();
+                }
+
+                m_read_cv.notify_all();
             }
         });
     }
@@ -45,7 +54,10 @@ namespace subprocess {
             m_context_thread.join();
         }
 
-        m_exception = nullptr;
+        {
+            std::lock_guard lock {m_read_mutex};
+            m_exception = nullptr;
+        }
 
         if (ec) {
             throw SubprocessError(ec.message());
@@ -53,7 +65,10 @@ namespace subprocess {
     }
 
     bool Subprocess::alive() {
-        throw_if_error();
+        {
+            std::lock_guard lock {m_read_mutex};
+            throw_if_error();
+        }
 
         boost_process::error_code ec;
         const bool result {m_process.running(ec)};
@@ -66,34 +81,74 @@ namespace subprocess {
     }
 
     std::string Subprocess::read_line() {
-        throw_if_error();
+        std::lock_guard lock {m_read_mutex};
 
-        {
-            std::lock_guard lock {m_read_mutex};
-            if (!m_reading_queue.empty()) {
-                const auto result {m_reading_queue.front()};
-                m_reading_queue.pop_front();
-                return result;
-            }
-        }
+        return take_line();
+    }
 
-        return {};
+    std::string Subprocess::read_line(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock lock {m_read_mutex};
+
+        m_read_cv.wait_until(lock, deadline, [this]() {
+            return !m_reading_queue.empty() || m_exception || m_interrupted;
+        });
+
+        return take_line();
     }
 
     void Subprocess::write_line(const std::string& data) {
-        throw_if_error();
+        {
+            std::lock_guard lock {m_read_mutex};
+            throw_if_error();
+        }
 
         const auto line {data + '\n'};
 
         boost_process::error_code ec;
-        boost::asio::write(m_in, boost::asio::const_buffer(line.data(), line.size()), ec);
+
+        {
+            trace::Span span {"write_line", data};
+
+            std::lock_guard lock {m_write_mutex};
+            boost::asio::write(m_in, boost::asio::const_buffer(line.data(), line.size()), ec);
+        }
 
         if (ec) {
             throw SubprocessError(ec.message());
         }
     }
 
+    void Subprocess::interrupt() {
+        {
+            std::lock_guard lock {m_read_mutex};
+            m_interrupted = true;
+        }
+
+        m_read_cv.notify_all();
+    }
+
+    std::string Subprocess::take_line() {
+        // The read mutex must be locked
+
+        if (m_interrupted) {
+            throw SubprocessError("Interrupted");
+        }
+
+        if (!m_reading_queue.empty()) {
+            auto result {std::move(m_reading_queue.front())};
+            m_reading_queue.pop_front();
+            m_last_read_time = result.time;
+            return std::move(result.data);
+        }
+
+        throw_if_error();
+
+        return {};
+    }
+
     void Subprocess::throw_if_error() {
+        // The read mutex must be locked
+
         if (m_exception) {
             try {
                 std::rethrow_exception(std::exchange(m_exception, nullptr));
@@ -123,12 +178,38 @@ namespace subprocess {
     void Subprocess::task_read_line() {
         boost::asio::async_read_until(m_out, boost::asio::dynamic_buffer(m_read_buffer), '\n', [this](boost_process::error_code ec, std::size_t) {
             if (ec) {
-                throw SubprocessError(ec.message());
+                // Most likely the end of file, meaning that the process has died; don't take the io thread down,
+                // but report the error on the next read or write
+                {
+                    std::lock_guard lock {m_read_mutex};
+                    m_exception = std::make_exception_ptr(SubprocessError(ec.message()));
+                }
+
+                m_read_cv.notify_all();
+
+                // Wake up the owner too, so that a dead process is noticed right away
+                if (m_read_callback) {
+                    m_read_callback();
+                }
+
+                return;
             }
 
+            // Take the time here, as the other thread may only get to the line much later
+            const auto now {std::chrono::steady_clock::now()};
+
+            auto line {extract_line(m_read_buffer)};
+            trace::instant("read_line", line);
+
             {
                 std::lock_guard lock {m_read_mutex};
-                m_reading_queue.push_back(extract_line(m_read_buffer));
+                m_reading_queue.push_back({std::move(line), now});
+            }
+
+            m_read_cv.notify_all();
+
+            if (m_read_callback) {
+                m_read_callback();
             }
 
             task_read_line();
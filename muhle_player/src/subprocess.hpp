@@ -3,9 +3,12 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <deque>
 #include <stdexcept>
 #include <exception>
+#include <functional>
 
 #ifdef __GNUG__
     #pragma GCC diagnostic push
@@ -38,8 +41,25 @@ namespace subprocess {
         void wait();
         bool alive();
         std::string read_line();
+        std::string read_line(std::chrono::steady_clock::time_point deadline);
+        // Can be called from any thread
         void write_line(const std::string& data);
+
+        // When the line last returned by read_line was received, as seen by the reader thread
+        std::chrono::steady_clock::time_point last_read_time() const { return m_last_read_time; }
+
+        // Wake up and fail any blocking read; can be called from any thread
+        void interrupt();
+
+        // Called on the reader thread after every line; must be set before open
+        void set_read_callback(const std::function<void()>& read_callback) { m_read_callback = read_callback; }
     private:
+        struct Line {
+            std::string data;
+            std::chrono::steady_clock::time_point time;
+        };
+
+        std::string take_line();
         void throw_if_error();
         void kill();
         static std::string extract_line(std::string& read_buffer);
@@ -51,11 +71,17 @@ namespace subprocess {
         boost_process::process m_process;
         std::thread m_context_thread;
 
+        std::mutex m_write_mutex;
         std::mutex m_read_mutex;
+        std::condition_variable m_read_cv;
         std::string m_read_buffer;
-        std::deque<std::string> m_reading_queue;
+        std::deque<Line> m_reading_queue;
+        std::function<void()> m_read_callback;
+        std::chrono::steady_clock::time_point m_last_read_time {};
 
+        // Protected by the read mutex
         std::exception_ptr m_exception;
+        bool m_interrupted {false};
     };
 
     struct SubprocessError : public std::runtime_error {
@@ -0,0 +1,65 @@
+#include "time_series.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace time_series {
+    TimeSeries::TimeSeries(std::size_t capacity)
+        : m_capacity(std::max(capacity - capacity % 2, std::size_t(2))) {
+        m_x.reserve(m_capacity);
+        m_y.reserve(m_capacity);
+    }
+
+    void TimeSeries::push(float x, float y) {
+        if (m_y.empty()) {
+            m_min = y;
+            m_max = y;
+        } else {
+            m_min = std::min(m_min, y);
+            m_max = std::max(m_max, y);
+        }
+
+        // Fold the sample into the last point, until that is complete
+        if (!m_y.empty() && m_last_samples < m_stride) {
+            const auto samples {static_cast<float>(m_last_samples)};
+
+            m_x.back() = x;
+            m_y.back() = (m_y.back() * samples + y) / (samples + 1.0f);
+            m_last_samples++;
+
+            return;
+        }
+
+        if (m_y.size() == m_capacity) {
+            decimate();
+        }
+
+        m_x.push_back(x);
+        m_y.push_back(y);
+        m_last_samples = 1;
+    }
+
+    void TimeSeries::clear() {
+        m_stride = 1;
+        m_last_samples = 0;
+        m_x.clear();
+        m_y.clear();
+        m_min = 0.0f;
+        m_max = 0.0f;
+    }
+
+    void TimeSeries::decimate() {
+        assert(m_y.size() % 2 == 0);
+
+        // Every point is complete at this moment
+        for (std::size_t i {0}; i < m_y.size() / 2; i++) {
+            m_x[i] = m_x[i * 2 + 1];
+            m_y[i] = (m_y[i * 2] + m_y[i * 2 + 1]) / 2.0f;
+        }
+
+        m_x.resize(m_x.size() / 2);
+        m_y.resize(m_y.size() / 2);
+        m_stride *= 2;
+        m_last_samples = m_stride;
+    }
+}
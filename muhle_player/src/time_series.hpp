@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace time_series {
+    // Keeps at most a fixed number of points; when full, neighboring points are averaged in pairs
+    // and from then on every point stands for twice as many samples
+    class TimeSeries {
+    public:
+        explicit TimeSeries(std::size_t capacity = 256);
+
+        void push(float x, float y);
+        void clear();
+
+        // Evenly spaced, so they can be plotted directly
+        const std::vector<float>& get_x() const { return m_x; }
+        const std::vector<float>& get_y() const { return m_y; }
+
+        std::size_t size() const { return m_y.size(); }
+        bool empty() const { return m_y.empty(); }
+        std::size_t get_stride() const { return m_stride; }
+        float get_min() const { return m_min; }
+        float get_max() const { return m_max; }
+    private:
+        void decimate();
+
+        std::size_t m_capacity {};
+        std::size_t m_stride {1};  // Samples per point
+        std::size_t m_last_samples {0};  // Samples in the last point, which may be incomplete
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        float m_min {};
+        float m_max {};
+    };
+}
@@ -0,0 +1,87 @@
+#include "timer.hpp"
+
+#include <utility>
+
+namespace timer {
+    Timer::Timer() {
+        m_thread = std::thread(&Timer::task, this);
+    }
+
+    Timer::~Timer() {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_quit = true;
+        }
+
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    void Timer::schedule(std::chrono::steady_clock::time_point deadline, std::function<void()>&& callback) {
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+
+            m_cv.wait(lock, [this]() { return !m_calling; });
+
+            m_deadline = deadline;
+            m_callback = std::move(callback);
+        }
+
+        m_cv.notify_all();
+    }
+
+    void Timer::cancel() {
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+
+            m_cv.wait(lock, [this]() { return !m_calling; });
+
+            m_deadline = std::nullopt;
+            m_callback = nullptr;
+        }
+
+        m_cv.notify_all();
+    }
+
+    void Timer::task() {
+        std::unique_lock<std::mutex> lock {m_mutex};
+
+        while (true) {
+            if (m_quit) {
+                return;
+            }
+
+            if (!m_deadline) {
+                m_cv.wait(lock);
+                continue;
+            }
+
+            // Any change wakes the thread up, so that the new deadline is picked up
+            const auto deadline {*m_deadline};
+
+            if (m_cv.wait_until(lock, deadline) == std::cv_status::no_timeout) {
+                continue;
+            }
+
+            if (!m_deadline || *m_deadline != deadline) {
+                continue;
+            }
+
+            auto callback {std::move(m_callback)};
+            m_deadline = std::nullopt;
+            m_callback = nullptr;
+            m_calling = true;
+
+            lock.unlock();
+
+            if (callback) {
+                callback();
+            }
+
+            lock.lock();
+
+            m_calling = false;
+            m_cv.notify_all();
+        }
+    }
+}
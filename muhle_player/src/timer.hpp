@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <optional>
+
+namespace timer {
+    // Calls a function on its own thread at a given time, independently of the frame rate
+    class Timer {
+    public:
+        Timer();
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        Timer(Timer&&) = delete;
+        Timer& operator=(Timer&&) = delete;
+
+        // Replace any pending call; the callback must not use the timer itself
+        void schedule(std::chrono::steady_clock::time_point deadline, std::function<void()>&& callback);
+
+        // After this returns, the callback is neither pending, nor running
+        void cancel();
+    private:
+        void task();
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::optional<std::chrono::steady_clock::time_point> m_deadline;
+        std::function<void()> m_callback;
+        bool m_calling {false};
+        bool m_quit {false};
+    };
+}
@@ -0,0 +1,324 @@
+#include "trace.hpp"
+
+#include <fstream>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+namespace trace {
+    static constexpr std::size_t TEXT_SIZE {96};
+    static constexpr std::size_t CHUNK_SIZE {1024};
+
+    struct Event {
+        const char* name {};
+        std::int64_t begin {};  // Nanoseconds on the steady clock
+        std::int64_t duration {-1};  // Instant events have none
+        std::array<char, TEXT_SIZE> text {};
+    };
+
+    // Filled by one thread only; others read up to the published size, which never goes back
+    struct Chunk {
+        std::array<Event, CHUNK_SIZE> events;
+        std::atomic<std::size_t> size {0};
+        std::atomic<Chunk*> next {nullptr};
+    };
+
+    struct Buffer {
+        Buffer() = default;
+
+        ~Buffer() {
+            clear();
+        }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        Buffer(Buffer&&) = delete;
+        Buffer& operator=(Buffer&&) = delete;
+
+        // Only with the registry mutex held, as the events may be being written
+        void clear() {
+            for (Chunk* chunk {head.load()}; chunk != nullptr;) {
+                Chunk* next {chunk->next.load()};
+                delete chunk;
+                chunk = next;
+            }
+
+            head.store(nullptr);
+            tail = nullptr;
+        }
+
+        std::atomic<Chunk*> head {nullptr};  // Chunks are only allocated as they are needed
+        Chunk* tail {nullptr};
+        unsigned int id {};
+        unsigned int generation {};  // Of the recording that the events belong to
+        bool finished {false};
+        std::string name;  // Protected by the registry mutex
+    };
+
+    // Buffers of finished threads are kept until the next recording starts, so that their events still get written
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        unsigned int next_id {0};
+        std::atomic<unsigned int> generation {0};
+        std::atomic<bool> recording {false};
+        std::atomic<std::int64_t> start {0};
+    };
+
+    static Registry& registry() {
+        static Registry registry;
+
+        return registry;
+    }
+
+    // The buffer is only created by the first event, so threads that are never traced cost nothing
+    struct ThreadState {
+        ThreadState() = default;
+        ~ThreadState();
+
+        ThreadState(const ThreadState&) = delete;
+        ThreadState& operator=(const ThreadState&) = delete;
+        ThreadState(ThreadState&&) = delete;
+        ThreadState& operator=(ThreadState&&) = delete;
+
+        Buffer* buffer {nullptr};
+        std::string name;
+    };
+
+    ThreadState::~ThreadState() {
+        if (buffer == nullptr) {
+            return;
+        }
+
+        Registry& r {registry()};
+        std::lock_guard<std::mutex> lock {r.mutex};
+
+        if (buffer->generation == r.generation.load() && buffer->head.load() != nullptr) {
+            buffer->finished = true;
+            return;
+        }
+
+        r.buffers.erase(std::find_if(r.buffers.begin(), r.buffers.end(), [this](const auto& entry) {
+            return entry.get() == buffer;
+        }));
+    }
+
+    static thread_local ThreadState t_thread;
+
+    static std::int64_t to_nanoseconds(Clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    static Buffer& thread_buffer() {
+        Registry& r {registry()};
+        const unsigned int generation {r.generation.load()};
+
+        if (t_thread.buffer == nullptr) {
+            std::lock_guard<std::mutex> lock {r.mutex};
+
+            r.buffers.push_back(std::make_unique<Buffer>());
+            r.buffers.back()->id = ++r.next_id;
+            r.buffers.back()->generation = generation;
+            r.buffers.back()->name = t_thread.name;
+
+            t_thread.buffer = r.buffers.back().get();
+        } else if (t_thread.buffer->generation != generation) {
+            // Only this thread adds to its buffer, so only it can drop the events of an earlier recording
+            std::lock_guard<std::mutex> lock {r.mutex};
+
+            t_thread.buffer->clear();
+            t_thread.buffer->generation = generation;
+        }
+
+        return *t_thread.buffer;
+    }
+
+    static void push(const char* name, std::int64_t begin, std::int64_t duration, std::string_view text) {
+        Buffer& buffer {thread_buffer()};
+        Chunk* chunk {buffer.tail};
+        std::size_t size {chunk != nullptr ? chunk->size.load(std::memory_order_relaxed) : CHUNK_SIZE};
+
+        if (size == CHUNK_SIZE) {
+            Chunk* next {new Chunk};
+
+            if (chunk == nullptr) {
+                buffer.head.store(next, std::memory_order_release);
+            } else {
+                chunk->next.store(next, std::memory_order_release);
+            }
+
+            buffer.tail = next;
+            chunk = next;
+            size = 0;
+        }
+
+        Event& event {chunk->events[size]};
+        event.name = name;
+        event.begin = begin;
+        event.duration = duration;
+
+        const std::size_t text_size {std::min(text.size(), TEXT_SIZE - 1)};
+        std::copy_n(text.data(), text_size, event.text.begin());
+        event.text[text_size] = '\0';
+
+        chunk->size.store(size + 1, std::memory_order_release);
+    }
+
+    void start() {
+        Registry& r {registry()};
+
+        {
+            std::lock_guard<std::mutex> lock {r.mutex};
+
+            // Threads that are still running drop their old events with their next one
+            r.buffers.erase(std::remove_if(r.buffers.begin(), r.buffers.end(), [](const auto& buffer) {
+                return buffer->finished;
+            }), r.buffers.end());
+        }
+
+        r.start.store(to_nanoseconds(Clock::now()));
+        r.generation++;
+        r.recording.store(true);
+    }
+
+    void stop() {
+        registry().recording.store(false);
+    }
+
+    bool recording() {
+        return registry().recording.load(std::memory_order_relaxed);
+    }
+
+    void set_thread_name(const char* name) {
+        t_thread.name = name;
+
+        if (t_thread.buffer != nullptr) {
+            std::lock_guard<std::mutex> lock {registry().mutex};
+            t_thread.buffer->name = name;
+        }
+    }
+
+    void instant(const char* name, std::string_view text) {
+        if (!recording()) {
+            return;
+        }
+
+        push(name, to_nanoseconds(Clock::now()), -1, text);
+    }
+
+    void complete(const char* name, Clock::time_point begin, Clock::time_point end, std::string_view text) {
+        if (!recording()) {
+            return;
+        }
+
+        push(name, to_nanoseconds(begin), to_nanoseconds(end) - to_nanoseconds(begin), text);
+    }
+
+    static void write_string(std::ofstream& stream, const char* string) {
+        stream << '"';
+
+        for (const char* c {string}; *c != '\0'; c++) {
+            switch (*c) {
+                case '"':
+                    stream << "\\\"";
+                    break;
+                case '\\':
+                    stream << "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) {
+                        char escaped[8] {};
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(*c));
+                        stream << escaped;
+                    } else {
+                        stream << *c;
+                    }
+
+                    break;
+            }
+        }
+
+        stream << '"';
+    }
+
+    static void write_microseconds(std::ofstream& stream, std::int64_t nanoseconds) {
+        char buffer[32] {};
+        std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(nanoseconds) / 1000.0);
+        stream << buffer;
+    }
+
+    void write(const std::string& file_path) {
+        Registry& r {registry()};
+        const std::int64_t start {r.start.load()};
+
+        std::ofstream stream {file_path, std::ios::trunc};
+
+        if (!stream.is_open()) {
+            throw TraceError("Could not open trace file `" + file_path + "`");
+        }
+
+        std::lock_guard<std::mutex> lock {r.mutex};
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        bool first {true};
+
+        for (const auto& buffer : r.buffers) {
+            if (!buffer->name.empty()) {
+                stream << (first ? "" : ",\n") << R"({"ph":"M","name":"thread_name","pid":1,"tid":)" << buffer->id;
+                stream << R"(,"args":{"name":)";
+                write_string(stream, buffer->name.c_str());
+                stream << "}}";
+                first = false;
+            }
+
+            if (buffer->generation != r.generation.load()) {
+                continue;
+            }
+
+            for (const Chunk* chunk {buffer->head.load(std::memory_order_acquire)}; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+                const std::size_t size {chunk->size.load(std::memory_order_acquire)};
+
+                for (std::size_t i {0}; i < size; i++) {
+                    const Event& event {chunk->events[i]};
+
+                    if (event.begin < start) {
+                        continue;
+                    }
+
+                    stream << (first ? "" : ",\n") << "{\"ph\":" << (event.duration < 0 ? R"("i","s":"t")" : R"("X")");
+                    stream << ",\"name\":";
+                    write_string(stream, event.name);
+                    stream << ",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":";
+                    write_microseconds(stream, event.begin - start);
+
+                    if (event.duration >= 0) {
+                        stream << ",\"dur\":";
+                        write_microseconds(stream, event.duration);
+                    }
+
+                    if (event.text[0] != '\0') {
+                        stream << ",\"args\":{\"text\":";
+                        write_string(stream, event.text.data());
+                        stream << '}';
+                    }
+
+                    stream << '}';
+                    first = false;
+                }
+            }
+        }
+
+        stream << "\n]}\n";
+
+        if (!stream) {
+            throw TraceError("Could not write trace file `" + file_path + "`");
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <stdexcept>
+
+namespace trace {
+    using Clock = std::chrono::steady_clock;
+
+    // Events are only kept while recording; starting again drops the earlier ones
+    void start();
+    void stop();
+    bool recording();
+
+    // Shown in the timeline instead of the thread number
+    void set_thread_name(const char* name);
+
+    // The name must be a string literal; the text is copied and may be truncated
+    void instant(const char* name, std::string_view text = {});
+    void complete(const char* name, Clock::time_point begin, Clock::time_point end, std::string_view text = {});
+
+    // Complete event from construction to destruction; the text must outlive the span
+    class Span {
+    public:
+        explicit Span(const char* name, std::string_view text = {})
+            : m_name(name), m_text(text), m_recording(recording()) {
+            if (m_recording) {
+                m_begin = Clock::now();
+            }
+        }
+
+        ~Span() {
+            if (m_recording) {
+                complete(m_name, m_begin, Clock::now(), m_text);
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+        Span(Span&&) = delete;
+        Span& operator=(Span&&) = delete;
+    private:
+        const char* m_name {};
+        std::string_view m_text;
+        bool m_recording {false};
+        Clock::time_point m_begin {};
+    };
+
+    // Chrome trace event format, which both chrome://tracing and Perfetto open
+    void write(const std::string& file_path);
+
+    struct TraceError : std::runtime_error {
+        explicit TraceError(const char* message)
+            : std::runtime_error(message) {}
+        explicit TraceError(const std::string& message)
+            : std::runtime_error(message) {}
+    };
+}
@@ -0,0 +1,92 @@
+#! /bin/bash
+
+# Timings only mean something on the machine they were taken on, so by default the merge base with
+# main (BENCH_BASE selects another branch) is built and run here too, and the results are compared
+# `./bench.sh update` records the baseline of this machine in muhle_bench/baselines instead,
+# and `./bench.sh stored` compares against it
+# Build in release mode first (./setup.sh rel)
+
+ROOT="$(cd .. && pwd)"
+BASELINES="$ROOT/muhle_bench/baselines"
+BASELINE="$BASELINES/$(hostname).json"
+
+./build.sh muhle_bench
+
+if [ "$?" -ne 0 ]; then
+    exit 1
+fi
+
+BENCH="$ROOT/build/muhle_bench/muhle_bench"
+
+if [ "$1" = "update" ]; then
+    mkdir -p "$BASELINES"
+    "$BENCH" --repetitions 30 --json "$BASELINE"
+    exit $?
+elif [ "$1" = "stored" ]; then
+    shift
+
+    if [ ! -f "$BASELINE" ]; then
+        echo "No baseline for $(hostname); record one with ./bench.sh update"
+        exit 1
+    fi
+
+    "$BENCH" --baseline "$BASELINE" "$@"
+    exit $?
+fi
+
+MERGE_BASE="$(git merge-base HEAD "${BENCH_BASE:-main}")"
+
+if [ "$?" -ne 0 ]; then
+    exit 1
+fi
+
+# On the branch itself, compare against the previous commit
+if [ "$MERGE_BASE" = "$(git rev-parse HEAD)" ]; then
+    MERGE_BASE="$(git rev-parse HEAD~1)"
+fi
+
+WORK="$(mktemp -d)"
+
+cleanup() {
+    git worktree remove --force "$WORK/src" > /dev/null 2>&1
+    rm -rf "$WORK"
+}
+
+trap cleanup EXIT
+
+git worktree add --quiet --detach "$WORK/src" "$MERGE_BASE"
+
+if [ "$?" -ne 0 ]; then
+    exit 1
+fi
+
+if [ ! -d "$WORK/src/muhle_bench" ]; then
+    echo "The merge base $MERGE_BASE has no benchmarks; nothing to compare against"
+    exit 0
+fi
+
+# The dependencies are taken from this tree instead of being checked out again
+mkdir -p "$WORK/src/extern"
+
+for MODULE in "$ROOT"/extern/*; do
+    rm -rf "$WORK/src/extern/$(basename "$MODULE")"
+    ln -s "$MODULE" "$WORK/src/extern/$(basename "$MODULE")"
+done
+
+cmake -S "$WORK/src" -B "$WORK/build" -DCMAKE_BUILD_TYPE=Release > /dev/null && \
+    cmake --build "$WORK/build" -j 8 --target muhle_bench > /dev/null
+
+if [ "$?" -ne 0 ]; then
+    echo "Could not build the merge base $MERGE_BASE"
+    exit 1
+fi
+
+echo "Running the merge base $MERGE_BASE"
+"$WORK/build/muhle_bench/muhle_bench" --repetitions 30 --json "$WORK/baseline.json"
+
+if [ "$?" -ne 0 ]; then
+    exit 1
+fi
+
+echo "Running this tree"
+"$BENCH" --baseline "$WORK/baseline.json" "$@"